@@ -0,0 +1,86 @@
+#include "PacketMarcher.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace marcher {
+	namespace cpu {
+		//What the CPU and OS support, regardless of what the build contains
+		SimdLevel CPUSimdLevel() {
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			int maxLeaf = info[0];
+			__cpuid(info, 1);
+			bool sse2 = (info[3] & (1 << 26)) != 0;
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			bool avx = (info[2] & (1 << 28)) != 0;
+			bool avx2 = false, avx512 = false;
+			if (maxLeaf >= 7 && osxsave && avx) {
+				//The OS has to save the ymm (and zmm) registers on context switches too
+				unsigned long long xcr0 = _xgetbv(0);
+				__cpuidex(info, 7, 0);
+				avx2 = (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+				avx512 = (xcr0 & 0xe6) == 0xe6 && (info[1] & (1 << 16)) != 0;
+			}
+#elif defined(__GNUC__)
+			bool sse2 = __builtin_cpu_supports("sse2");
+			bool avx2 = __builtin_cpu_supports("avx2");
+			bool avx512 = __builtin_cpu_supports("avx512f");
+#else
+			bool sse2 = false, avx2 = false, avx512 = false;
+#endif
+			if (avx512) return SIMD_AVX512;
+			if (avx2) return SIMD_AVX2;
+			if (sse2) return SIMD_SSE2;
+			return SIMD_SCALAR;
+		}
+
+		SimdLevel DetectSimdLevel() {
+			int level = CPUSimdLevel();
+			while (level > SIMD_SCALAR && !GetPacketMarcher((SimdLevel)level))
+				level--;
+			return (SimdLevel)level;
+		}
+
+		PacketMarcher GetPacketMarcher(SimdLevel level, PacketKernel kernel) {
+			switch (level) {
+			case SIMD_SSE2:
+				return sse2::GetPacketMarcher(kernel);
+			case SIMD_AVX2:
+				return avx2::GetPacketMarcher(kernel);
+			case SIMD_AVX512:
+				return avx512::GetPacketMarcher(kernel);
+			default:
+				return nullptr;
+			}
+		}
+
+		int PacketWidth(SimdLevel level) {
+			switch (level) {
+			case SIMD_SSE2:
+				return 4;
+			case SIMD_AVX2:
+				return 8;
+			case SIMD_AVX512:
+				return 16;
+			default:
+				return 1;
+			}
+		}
+
+		const char* SimdLevelName(SimdLevel level) {
+			switch (level) {
+			case SIMD_SSE2:
+				return "SSE2";
+			case SIMD_AVX2:
+				return "AVX2";
+			case SIMD_AVX512:
+				return "AVX-512";
+			default:
+				return "Scalar";
+			}
+		}
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Scene.h"
+#include "RenderTypes.h"
+
+/*
+	Packet marchers advance several primary rays through March() at once, one SIMD lane per ray.
+	Rays that hit or pass MaxDistance are masked off while the rest of the packet keeps stepping.
+*/
+
+namespace marcher {
+	namespace cpu {
+		enum SimdLevel {
+			SIMD_SCALAR,
+			SIMD_SSE2,
+			SIMD_AVX2,
+			SIMD_AVX512
+		};
+
+		//Marches count rays (at most the packet width), only Hit, Depth, MinDistance and Steps of out are filled
+		typedef void(*PacketMarcher)(const Scene& scene, const RenderSettings& settings, const Ray* rays, int count, MarchInfo* out);
+
+		//The widest level supported by both the CPU and the build
+		SimdLevel DetectSimdLevel();
+		//Returns nullptr for SIMD_SCALAR and levels the build doesn't include
+		PacketMarcher GetPacketMarcher(SimdLevel level, PacketKernel kernel = KERNEL_BATCHED);
+		int PacketWidth(SimdLevel level);
+		const char* SimdLevelName(SimdLevel level);
+
+		//Each of these lives in its own translation unit compiled for that instruction set
+		namespace sse2 { PacketMarcher GetPacketMarcher(PacketKernel kernel); }
+		namespace avx2 { PacketMarcher GetPacketMarcher(PacketKernel kernel); }
+		namespace avx512 { PacketMarcher GetPacketMarcher(PacketKernel kernel); }
+	}
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "PacketMarcher.h"
+#include "Simd.h"
+
+/*
+	The packet version of March() in HeaderFS, included by each instruction set specific translation unit.
+	Stay away from glm and other inline library code in here: the linker is free to keep the AVX compiled copy of an inline function for the whole program.
+*/
+
+namespace marcher {
+	namespace cpu {
+		//Hands the packet to the scene's batched Distance()
+		template<class F>
+		struct BatchedKernel {
+			static F Distance(const Scene& scene, F x, F y, F z) {
+				alignas(64) float px[F::Width], py[F::Width], pz[F::Width], dist[F::Width];
+				x.Store(px);
+				y.Store(py);
+				z.Store(pz);
+				scene.Distance(px, py, pz, dist, F::Width);
+				return F::Load(dist);
+			}
+		};
+
+		//DefaultScene::Distance() at packet width
+		template<class F>
+		struct DefaultSceneKernel {
+			static F Distance(const Scene&, F x, F y, F z) {
+				F offset = Sin(x * F(20.f)) * F(0.01f);
+				F dx = x + offset, dy = y + offset - F(1.f), dz = z + offset;
+				F sphere = Sqrt(dx * dx + dy * dy + dz * dz) - F(1.f);
+				return Min(sphere, y);
+			}
+		};
+
+		template<class F, class Kernel>
+		void MarchPacket(const Scene& scene, const RenderSettings& settings, const Ray* rays, int count, MarchInfo* out) {
+			typedef typename F::Mask M;
+			const int W = F::Width;
+
+			alignas(64) float ox[W], oy[W], oz[W], dx[W], dy[W], dz[W], lanes[W];
+			for (int l = 0; l < W; l++) {
+				//Unused lanes copy the first ray so they stay well behaved, they start out inactive
+				const Ray& ray = rays[l < count ? l : 0];
+				ox[l] = ray.Origin.x; oy[l] = ray.Origin.y; oz[l] = ray.Origin.z;
+				dx[l] = ray.Direction.x; dy[l] = ray.Direction.y; dz[l] = ray.Direction.z;
+				lanes[l] = (float)l;
+			}
+			F Ox = F::Load(ox), Oy = F::Load(oy), Oz = F::Load(oz);
+			F Dx = F::Load(dx), Dy = F::Load(dy), Dz = F::Load(dz);
+
+			const F epsilon = settings.Epsilon, maxDistance = settings.MaxDistance, zero = 0.f, one = 1.f;
+			F depth = 0.f, minDist = maxDistance, steps = (float)settings.MaxSteps;
+			F relaxation = settings.MarchRelaxation, stepLength = 0.f, lastDist = 0.f;
+			M active = F::Load(lanes) < F((float)count);
+			M hit = zero < zero;
+
+			for (int i = 0; i < settings.MaxSteps && Any(active); i++) {
+				F d = Kernel::Distance(scene, Ox + Dx * depth, Oy + Dy * depth, Oz + Dz * depth);
+
+				//Lanes whose relaxed step overshot or landed inside go back to the unrelaxed step and stay unrelaxed, they take no other part in this step
+				M overshot = active & (one < relaxation) & ((d < zero) | (d + lastDist < stepLength));
+				depth = Select(overshot, depth - (stepLength - lastDist), depth);
+				relaxation = Select(overshot, one, relaxation);
+				M stepping = AndNot(active, overshot);
+
+				minDist = Select(stepping, Min(d, minDist), minDist);
+
+				//A hit reports the last distance as MinDistance and steps back out of the surface like the shader does
+				M h = stepping & (d < epsilon);
+				F backOff = Select(d < zero, d + d, zero);
+				depth = Select(h, depth + backOff, depth);
+				minDist = Select(h, d, minDist);
+				steps = Select(h, F((float)i), steps);
+				hit = hit | h;
+				active = AndNot(active, h);
+				stepping = AndNot(stepping, h);
+
+				//Only the unrelaxed step is known to be empty, so that's what has to reach the max distance
+				M miss = stepping & (depth + d >= maxDistance);
+				depth = Select(miss, depth + d, Select(stepping, depth + d * relaxation, depth));
+				lastDist = Select(stepping, d, lastDist);
+				stepLength = Select(stepping, d * relaxation, stepLength);
+				steps = Select(miss, F((float)i), steps);
+				active = AndNot(active, miss);
+			}
+
+			alignas(64) float depths[W], minDists[W], stepCounts[W];
+			depth.Store(depths);
+			minDist.Store(minDists);
+			steps.Store(stepCounts);
+			int hitBits = Bits(hit);
+			for (int l = 0; l < count; l++) {
+				out[l].Hit = (hitBits >> l) & 1;
+				out[l].Depth = depths[l];
+				out[l].MinDistance = minDists[l];
+				out[l].Steps = (int)stepCounts[l];
+			}
+		}
+
+		template<class F>
+		PacketMarcher SelectPacketMarcher(PacketKernel kernel) {
+			switch (kernel) {
+			case KERNEL_DEFAULT_SCENE:
+				return MarchPacket<F, DefaultSceneKernel<F>>;
+			default:
+				return MarchPacket<F, BatchedKernel<F>>;
+			}
+		}
+	}
+}
@@ -0,0 +1,15 @@
+#include "PacketMarcher.inl"
+
+//Compiled with /arch:AVX2, nothing in here may run before DetectSimdLevel() has checked the CPU
+
+namespace marcher {
+	namespace cpu {
+		namespace avx2 {
+#ifdef __AVX2__
+			PacketMarcher GetPacketMarcher(PacketKernel kernel) { return SelectPacketMarcher<simd::Float8>(kernel); }
+#else
+			PacketMarcher GetPacketMarcher(PacketKernel) { return nullptr; }
+#endif
+		}
+	}
+}
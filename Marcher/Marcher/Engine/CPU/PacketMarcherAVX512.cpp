@@ -0,0 +1,15 @@
+#include "PacketMarcher.inl"
+
+//Compiled with /arch:AVX512, nothing in here may run before DetectSimdLevel() has checked the CPU
+
+namespace marcher {
+	namespace cpu {
+		namespace avx512 {
+#ifdef __AVX512F__
+			PacketMarcher GetPacketMarcher(PacketKernel kernel) { return SelectPacketMarcher<simd::Float16>(kernel); }
+#else
+			PacketMarcher GetPacketMarcher(PacketKernel) { return nullptr; }
+#endif
+		}
+	}
+}
@@ -0,0 +1,13 @@
+#include "PacketMarcher.inl"
+
+namespace marcher {
+	namespace cpu {
+		namespace sse2 {
+#ifdef MARCHER_SIMD_SSE2
+			PacketMarcher GetPacketMarcher(PacketKernel kernel) { return SelectPacketMarcher<simd::Float4>(kernel); }
+#else
+			PacketMarcher GetPacketMarcher(PacketKernel) { return nullptr; }
+#endif
+		}
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "../Maths.h"
+
+/*
+	The structs shared between the scalar and packet paths of the CPU renderer. They mirror the uniforms and structs of HeaderFS.
+*/
+
+namespace marcher {
+	namespace cpu {
+		//Everything that HeaderFS receives as a uniform, apart from the camera
+		struct RenderSettings {
+			float Epsilon = 0.005f;
+			float MaxDistance = 200.f;
+			int MaxSteps = 1024;
+			//Primary rays step this many times the distance while that stays safe, 1 is plain sphere tracing
+			float MarchRelaxation = 1.f;
+
+			bool ShadowsEnabled = true;
+			float ShadowStrength = 1.f;
+			//Shadow rays give up as lit after ShadowSteps steps or ShadowDistance, or once they leave SceneMin to SceneMax when SceneBounded is set
+			int ShadowSteps = 128;
+			float ShadowDistance = 50.f;
+			bool SceneBounded = false;
+			glm::vec3 SceneMin = glm::vec3(0.f), SceneMax = glm::vec3(0.f);
+			//How sharp the penumbra is, 0 gives hard shadows
+			float ShadowSoftness = 16.f;
+			float AOStrength = 1.f;
+
+			glm::vec3 AmbientColor = glm::vec3(0.05f);
+			glm::vec3 LightColor = glm::vec3(1.f);
+			glm::vec3 LightDir = glm::vec3(-1.f);
+		};
+
+		struct Ray {
+			glm::vec3 Origin, Direction;
+		};
+
+		struct MarchInfo {
+			bool Hit;
+			float Depth, MinDistance;
+			glm::vec3 Position, Normal;
+			int Steps;
+		};
+	}
+}
@@ -0,0 +1,260 @@
+#include "Renderer.h"
+
+#include <atomic>
+#include <thread>
+
+#include "../Timer.h"
+#include "../Sampling.h"
+
+namespace marcher {
+	namespace cpu {
+		Renderer::Renderer(std::shared_ptr<Scene> scene, unsigned int threadCount, SimdLevel simdLevel)
+			: m_scene(scene) {
+			if (threadCount == 0)
+				threadCount = glm::max(std::thread::hardware_concurrency(), 1u);
+			m_scheduler = std::unique_ptr<TileScheduler>(new TileScheduler(threadCount));
+			SetSimdLevel(simdLevel);
+		}
+
+		void Renderer::SetSimdLevel(SimdLevel level) {
+			m_simdLevel = (SimdLevel)glm::min((int)level, (int)DetectSimdLevel());
+			m_packetMarcher = GetPacketMarcher(m_simdLevel, m_scene->GetPacketKernel());
+		}
+
+		void Renderer::Render(const Camera& camera, const RenderSettings& settings, int width, int height, std::vector<glm::vec3>& pixels, int samples) {
+			pixels.resize((size_t)width * height);
+			Tile region = { 0, 0, width, height };
+			RenderRegion(camera, settings, width, height, region, &pixels[0], samples);
+		}
+
+		void Renderer::RenderRegion(const Camera& camera, const RenderSettings& settings, int width, int height, const Tile& region, glm::vec3* pixels, int samples) {
+			Timer timer;
+
+			std::atomic<unsigned long long> steps(0), primarySteps(0);
+			m_scheduler->Run(region, [&](const Tile& tile) {
+				glm::vec3* tilePixels = pixels + (size_t)(tile.Y - region.Y) * region.Width + (tile.X - region.X);
+				unsigned long long tilePrimarySteps = 0;
+				unsigned long long tileSteps = RenderTile(camera, settings, width, height, tile, tilePixels, region.Width, samples, &tilePrimarySteps);
+				steps += tileSteps;
+				primarySteps += tilePrimarySteps;
+				return tileSteps;
+			});
+
+			m_stats.Rays = (unsigned long long)region.Width * region.Height * glm::max(samples, 1);
+			m_stats.Steps = steps;
+			m_stats.PrimarySteps = primarySteps;
+			m_stats.Seconds = timer.CurrentTime<float>();
+		}
+
+		unsigned long long Renderer::RenderTile(const Camera& camera, const RenderSettings& settings, int width, int height, const Tile& tile, glm::vec3* pixels, int stride, int samples, unsigned long long* primarySteps) const {
+			glm::vec2 screenSize = glm::vec2(width, height);
+			unsigned long long steps = 0, primary = 0;
+			samples = glm::max(samples, 1);
+			if (m_packetMarcher) {
+				//Packets cover small blocks rather than rows, the rays of a block take the most similar paths
+				int packetWidth = PacketWidth(m_simdLevel);
+				int blockWidth = packetWidth >= 8 ? 4 : 2;
+				int blockHeight = packetWidth / blockWidth;
+
+				Ray rays[16];
+				MarchInfo infos[16];
+				int offsets[16];
+				glm::vec3 colors[16];
+				for (int by = 0; by < tile.Height; by += blockHeight) {
+					for (int bx = 0; bx < tile.Width; bx += blockWidth) {
+						int count = 0;
+						for (int s = 0; s < samples; s++) {
+							glm::vec2 offset = SampleOffset(s, samples);
+							count = 0;
+							for (int y = by; y < glm::min(by + blockHeight, tile.Height); y++) {
+								//gl_FragCoord has its origin at the bottom left, rows here are counted from the top
+								float fragY = (float)(height - 1 - (tile.Y + y)) + offset.y;
+								for (int x = bx; x < glm::min(bx + blockWidth, tile.Width); x++) {
+									rays[count] = CalculateFragRay(camera, glm::vec2((float)(tile.X + x) + offset.x, fragY), screenSize);
+									offsets[count++] = y * stride + x;
+								}
+							}
+
+							m_packetMarcher(*m_scene, settings, rays, count, infos);
+
+							for (int i = 0; i < count; i++) {
+								MarchInfo& info = infos[i];
+								glm::vec3 color = glm::vec3(0);
+								steps += info.Steps + 1;
+								primary += info.Steps + 1;
+								//The first step is taken at the ray origin, so hitting there is main()'s inside check
+								if (!info.Hit || info.Steps != 0) {
+									info.Position = rays[i].Origin + rays[i].Direction * info.Depth;
+									info.Normal = info.Hit ? EstimateNormal(settings, info.Position) : glm::vec3(0);
+									int shadowSteps = 0;
+									color = Render(settings, rays[i], info, &shadowSteps);
+									steps += shadowSteps;
+								}
+								colors[i] = s == 0 ? color : colors[i] + color;
+							}
+						}
+
+						for (int i = 0; i < count; i++)
+							pixels[offsets[i]] = colors[i] / (float)samples;
+					}
+				}
+				if (primarySteps)
+					*primarySteps += primary;
+				return steps;
+			}
+
+			for (int y = 0; y < tile.Height; y++) {
+				for (int x = 0; x < tile.Width; x++) {
+					glm::vec3 color = glm::vec3(0);
+					for (int s = 0; s < samples; s++) {
+						glm::vec2 offset = SampleOffset(s, samples);
+						int pixelSteps = 0, pixelPrimarySteps = 0;
+						color += Shade(camera, settings, glm::vec2((float)(tile.X + x) + offset.x, (float)(height - 1 - (tile.Y + y)) + offset.y), screenSize, &pixelSteps, &pixelPrimarySteps);
+						steps += pixelSteps;
+						primary += pixelPrimarySteps;
+					}
+					pixels[(size_t)y * stride + x] = color / (float)samples;
+				}
+			}
+			if (primarySteps)
+				*primarySteps += primary;
+			return steps;
+		}
+
+		Ray Renderer::CalculateFragRay(const Camera& camera, glm::vec2 fragCoord, glm::vec2 screenSize) const {
+			glm::vec2 RelScreenPos = fragCoord / screenSize;
+
+			glm::vec3 TopPos = glm::mix(camera.TopLeft, camera.TopRight, RelScreenPos.x);
+			glm::vec3 BottomPos = glm::mix(camera.BottomLeft, camera.BottomRight, RelScreenPos.x);
+			glm::vec3 FinalPos = glm::mix(TopPos, BottomPos, RelScreenPos.y);
+			return { FinalPos, glm::normalize(FinalPos - camera.Position) };
+		}
+
+		glm::vec3 Renderer::EstimateNormal(const RenderSettings& settings, const glm::vec3& p) const {
+			glm::vec3 gradient;
+			if (m_scene->Gradient(p, gradient))
+				return glm::normalize(gradient);
+
+			//Four taps on the corners of a tetrahedron, instead of six on the axes
+			const glm::vec2 k = glm::vec2(1, -1);
+			glm::vec3 a = glm::vec3(k.x, k.y, k.y), b = glm::vec3(k.y, k.y, k.x), c = glm::vec3(k.y, k.x, k.y), d = glm::vec3(k.x);
+			return glm::normalize(a * m_scene->Distance(p + a * settings.Epsilon) + b * m_scene->Distance(p + b * settings.Epsilon)
+				+ c * m_scene->Distance(p + c * settings.Epsilon) + d * m_scene->Distance(p + d * settings.Epsilon));
+		}
+
+		MarchInfo Renderer::March(const RenderSettings& settings, const Ray& ray) const {
+			float depth = 0.f;
+			float dist = 0.f, minDist = settings.MaxDistance;
+			float relaxation = settings.MarchRelaxation;
+			float stepLength = 0.f, lastDist = 0.f;
+			int i = 0;
+			for (; i < settings.MaxSteps; i++) {
+				dist = m_scene->Distance(ray.Origin + (ray.Direction * depth));
+				if (relaxation > 1.f && (dist < 0.f || dist + lastDist < stepLength)) {
+					depth -= stepLength - lastDist;
+					relaxation = 1.f;
+					continue;
+				}
+				minDist = glm::min(dist, minDist);
+				if (dist < settings.Epsilon) {
+					if (dist < 0) {
+						depth += dist; depth += dist;
+					}
+					glm::vec3 position = ray.Origin + (ray.Direction * depth);
+					return { true, depth, dist, position, EstimateNormal(settings, position), i };
+				}
+				if (depth + dist >= settings.MaxDistance) {
+					depth += dist;
+					return { false, depth, minDist, ray.Origin + (ray.Direction * depth), glm::vec3(0), i };
+				}
+				lastDist = dist;
+				stepLength = dist * relaxation;
+				depth += stepLength;
+			}
+			return { false, depth, minDist, ray.Origin + (ray.Direction * depth), glm::vec3(0), i };
+		}
+
+		float Renderer::ShadowRange(const RenderSettings& settings, const Ray& ray) const {
+			float range = settings.ShadowDistance;
+			if (settings.SceneBounded) {
+				glm::vec3 direction = glm::mix(ray.Direction, glm::vec3(1e-6f), glm::equal(ray.Direction, glm::vec3(0.f)));
+				glm::vec3 exit = glm::max((settings.SceneMin - ray.Origin) / direction, (settings.SceneMax - ray.Origin) / direction);
+				range = glm::min(range, glm::min(exit.x, glm::min(exit.y, exit.z)));
+			}
+			return range;
+		}
+
+		float Renderer::Shadow(const RenderSettings& settings, const Ray& ray, int* steps) const {
+			float range = ShadowRange(settings, ray);
+			float light = 1.f;
+			float t = settings.Epsilon;
+			for (int i = 0; i < settings.ShadowSteps && t < range; i++) {
+				if (steps)
+					(*steps)++;
+				float h = m_scene->Distance(ray.Origin + ray.Direction * t);
+				if (settings.ShadowSoftness > 0.f)
+					light = glm::min(light, settings.ShadowSoftness * h / t);
+				if (h < settings.Epsilon || light < 0.01f)
+					return 0;
+				t += h;
+			}
+			return light;
+		}
+
+		float Renderer::GenAmbientOcclusion(const RenderSettings& settings, const glm::vec3& ro, const glm::vec3& rd) const {
+			float totao = 0.f;
+			float sca = 1.f;
+
+			for (int aoi = 0; aoi < 5; aoi++) {
+				float hr = 0.01f + 0.02f * float(aoi * aoi);
+				glm::vec3 aopos = ro + rd * hr;
+				float dd = m_scene->Distance(aopos);
+				float ao = glm::clamp(-(dd - hr), 0.f, 1.f);
+				totao += ao * sca;
+				sca *= 0.75f;
+			}
+
+			return 1.f - glm::clamp(settings.AOStrength * totao, 0.f, 1.f);
+		}
+
+		glm::vec3 Renderer::Render(const RenderSettings& settings, const Ray& ray) const {
+			return Render(settings, ray, March(settings, ray));
+		}
+
+		glm::vec3 Renderer::Render(const RenderSettings& settings, const Ray& ray, const MarchInfo& info, int* shadowSteps) const {
+			if (info.Hit) {
+				glm::vec3 lightDir = glm::normalize(-settings.LightDir);
+				float shadow = 0.f;
+				//Surfaces facing away from the light are unlit either way
+				float diffuse = glm::dot(info.Normal, lightDir);
+				if (settings.ShadowsEnabled && diffuse > 0.f) {
+					shadow = 1.f - Shadow(settings, { info.Position + info.Normal * settings.Epsilon * 2.f, lightDir }, shadowSteps);
+				}
+
+				glm::vec3 ret = settings.LightColor * glm::max(diffuse, 0.f);
+				ret -= glm::vec3(shadow * settings.ShadowStrength) * ret;
+				ret += settings.AmbientColor * (glm::vec3(1) - ret);
+
+				ret *= GenAmbientOcclusion(settings, info.Position + info.Normal * settings.Epsilon, info.Normal);
+				return glm::mix(ret, settings.AmbientColor, glm::distance(ray.Origin, info.Position) / settings.MaxDistance);
+			}
+			return settings.AmbientColor;
+		}
+
+		glm::vec3 Renderer::Shade(const Camera& camera, const RenderSettings& settings, glm::vec2 fragCoord, glm::vec2 screenSize, int* steps, int* primarySteps) const {
+			Ray camRay = CalculateFragRay(camera, fragCoord, screenSize);
+
+			if (m_scene->Distance(camRay.Origin) < settings.Epsilon) {
+				return glm::vec3(0);
+			}
+			MarchInfo info = March(settings, camRay);
+			int shadowSteps = 0;
+			glm::vec3 color = Render(settings, camRay, info, &shadowSteps);
+			if (steps)
+				*steps += info.Steps + 1 + shadowSteps;
+			if (primarySteps)
+				*primarySteps += info.Steps + 1;
+			return color;
+		}
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "../Maths.h"
+#include "../Graphics/Camera.h"
+#include "Scene.h"
+#include "RenderTypes.h"
+#include "PacketMarcher.h"
+#include "TileScheduler.h"
+
+/*
+	The CPU renderer is a straight port of the fragment shader in HeaderFS, so it can render without a GPU and serve as a reference.
+	Every function here has a GLSL counterpart of the same name, keep them in sync.
+*/
+
+namespace marcher {
+	namespace cpu {
+		struct RenderStats {
+			unsigned long long Rays = 0;
+			//Primary and shadow march steps
+			unsigned long long Steps = 0;
+			//Just the primary ones
+			unsigned long long PrimarySteps = 0;
+			float Seconds = 0.f;
+		};
+
+		class Renderer {
+		public:
+			//threadCount of 0 uses every hardware thread
+			Renderer(std::shared_ptr<Scene> scene, unsigned int threadCount = 0, SimdLevel simdLevel = DetectSimdLevel());
+
+			//Primary rays are marched in packets at this level, SIMD_SCALAR marches one ray at a time. Levels the machine can't run are lowered
+			void SetSimdLevel(SimdLevel level);
+			SimdLevel GetSimdLevel() const { return m_simdLevel; }
+
+			//Renders a full frame into pixels (row major, top row first). The camera must have been updated with a matching aspect ratio.
+			//With more than one sample per pixel the samples are spread over the pixel and averaged
+			void Render(const Camera& camera, const RenderSettings& settings, int width, int height, std::vector<glm::vec3>& pixels, int samples = 1);
+			//Renders only region of a width*height frame, pixels holds region.Width*region.Height colors
+			void RenderRegion(const Camera& camera, const RenderSettings& settings, int width, int height, const Tile& region, glm::vec3* pixels, int samples = 1);
+			//Renders a single tile of a width*height frame on the calling thread, pixels points at the tile's top left pixel. Returns the march steps it took,
+			//primarySteps, when given, is incremented by the primary ones
+			unsigned long long RenderTile(const Camera& camera, const RenderSettings& settings, int width, int height, const Tile& tile, glm::vec3* pixels, int stride, int samples = 1, unsigned long long* primarySteps = nullptr) const;
+
+			Ray CalculateFragRay(const Camera& camera, glm::vec2 fragCoord, glm::vec2 screenSize) const;
+			glm::vec3 EstimateNormal(const RenderSettings& settings, const glm::vec3& p) const;
+			MarchInfo March(const RenderSettings& settings, const Ray& ray) const;
+			float ShadowRange(const RenderSettings& settings, const Ray& ray) const;
+			//Returns how much light gets through, from 0 to 1. steps, when given, is incremented once per step taken
+			float Shadow(const RenderSettings& settings, const Ray& ray, int* steps = nullptr) const;
+			float GenAmbientOcclusion(const RenderSettings& settings, const glm::vec3& ro, const glm::vec3& rd) const;
+			glm::vec3 Render(const RenderSettings& settings, const Ray& ray) const;
+			//Shades a ray that has already been marched
+			glm::vec3 Render(const RenderSettings& settings, const Ray& ray, const MarchInfo& info, int* shadowSteps = nullptr) const;
+			//The equivalent of main() in HeaderFS
+			glm::vec3 Shade(const Camera& camera, const RenderSettings& settings, glm::vec2 fragCoord, glm::vec2 screenSize, int* steps = nullptr, int* primarySteps = nullptr) const;
+
+			const RenderStats& LastFrameStats() const { return m_stats; }
+			unsigned int ThreadCount() const { return m_scheduler->ThreadCount(); }
+			const std::vector<ThreadStats>& GetThreadStats() const { return m_scheduler->GetThreadStats(); }
+
+		private:
+			std::shared_ptr<Scene> m_scene;
+			std::unique_ptr<TileScheduler> m_scheduler;
+			SimdLevel m_simdLevel;
+			PacketMarcher m_packetMarcher;
+			RenderStats m_stats;
+		};
+	}
+}
@@ -0,0 +1,17 @@
+#include "Scene.h"
+
+namespace marcher {
+	namespace cpu {
+		void Scene::Distance(const float* x, const float* y, const float* z, float* out, int count) const {
+			for (int i = 0; i < count; i++)
+				out[i] = Distance(glm::vec3(x[i], y[i], z[i]));
+		}
+
+		float DefaultScene::Distance(const glm::vec3& p) const {
+			float sphere = glm::distance(p + glm::vec3(std::sin(p.x * 20) * 0.01f), glm::vec3(0, 1, 0)) - 1;
+			float plane = p.y;
+
+			return glm::min(sphere, plane);
+		}
+	}
+}
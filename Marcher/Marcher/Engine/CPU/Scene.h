@@ -0,0 +1,39 @@
+#pragma once
+
+#include "../Maths.h"
+
+/*
+	Host side scenes for the CPU renderer. A Scene plays the role of the SceneSDF function that gets appended to HeaderFS.
+*/
+
+namespace marcher {
+	namespace cpu {
+		//Distance functions the packet marchers have compiled for each instruction set, everything else goes through the batched Distance()
+		enum PacketKernel {
+			KERNEL_BATCHED,
+			KERNEL_DEFAULT_SCENE
+		};
+
+		class Scene {
+		public:
+			virtual ~Scene() {}
+
+			virtual float Distance(const glm::vec3& p) const = 0;
+			//Evaluates count points given as separate x, y and z arrays, this is what the packet marchers call once per step.
+			//Scenes that can evaluate several points at once should override it, the default just loops over Distance()
+			virtual void Distance(const float* x, const float* y, const float* z, float* out, int count) const;
+			//Scenes that know their gradient write it and return true, the others return false and get their normals from four Distance() calls
+			virtual bool Gradient(const glm::vec3& /*p*/, glm::vec3& /*gradient*/) const { return false; }
+			//Scenes with a kernel in PacketMarcher.inl return it here so the packets don't go through the batched Distance()
+			virtual PacketKernel GetPacketKernel() const { return KERNEL_BATCHED; }
+		};
+
+		//The same scene as DefaultShader in main.cpp
+		class DefaultScene : public Scene {
+		public:
+			float Distance(const glm::vec3& p) const override;
+			//DefaultSceneKernel in PacketMarcher.inl has to be kept in sync with Distance()
+			PacketKernel GetPacketKernel() const override { return KERNEL_DEFAULT_SCENE; }
+		};
+	}
+}
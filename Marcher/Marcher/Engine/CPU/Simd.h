@@ -0,0 +1,146 @@
+#pragma once
+
+#include <immintrin.h>
+
+/*
+	Thin wrappers around the SSE2, AVX2 and AVX-512 float registers so the packet kernels can be written once as a template.
+	A wrapper only exists when the translation unit including this header is compiled for that instruction set.
+*/
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MARCHER_SIMD_SSE2
+#endif
+
+namespace marcher {
+	namespace simd {
+#ifdef MARCHER_SIMD_SSE2
+		struct Mask4 {
+			__m128 v;
+		};
+
+		struct Float4 {
+			typedef Mask4 Mask;
+			static const int Width = 4;
+
+			__m128 v;
+
+			Float4() {}
+			Float4(__m128 v) : v(v) {}
+			Float4(float f) : v(_mm_set1_ps(f)) {}
+
+			static Float4 Load(const float* p) { return _mm_load_ps(p); }
+			void Store(float* p) const { _mm_store_ps(p, v); }
+		};
+
+		inline Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.v, b.v); }
+		inline Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.v, b.v); }
+		inline Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.v, b.v); }
+		inline Float4 Min(Float4 a, Float4 b) { return _mm_min_ps(a.v, b.v); }
+		inline Float4 Sqrt(Float4 a) { return _mm_sqrt_ps(a.v); }
+		//To the nearest integer, SSE2 only has that through a round trip to ints so it's limited to their range
+		inline Float4 Round(Float4 a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a.v)); }
+		inline Mask4 operator<(Float4 a, Float4 b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+		inline Mask4 operator>=(Float4 a, Float4 b) { return { _mm_cmpge_ps(a.v, b.v) }; }
+
+		inline Mask4 operator&(Mask4 a, Mask4 b) { return { _mm_and_ps(a.v, b.v) }; }
+		inline Mask4 operator|(Mask4 a, Mask4 b) { return { _mm_or_ps(a.v, b.v) }; }
+		//a and not b
+		inline Mask4 AndNot(Mask4 a, Mask4 b) { return { _mm_andnot_ps(b.v, a.v) }; }
+		inline bool Any(Mask4 m) { return _mm_movemask_ps(m.v) != 0; }
+		inline int Bits(Mask4 m) { return _mm_movemask_ps(m.v); }
+		//Picks a where the mask is set and b elsewhere
+		inline Float4 Select(Mask4 m, Float4 a, Float4 b) { return _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)); }
+#endif
+
+#ifdef __AVX2__
+		struct Mask8 {
+			__m256 v;
+		};
+
+		struct Float8 {
+			typedef Mask8 Mask;
+			static const int Width = 8;
+
+			__m256 v;
+
+			Float8() {}
+			Float8(__m256 v) : v(v) {}
+			Float8(float f) : v(_mm256_set1_ps(f)) {}
+
+			static Float8 Load(const float* p) { return _mm256_load_ps(p); }
+			void Store(float* p) const { _mm256_store_ps(p, v); }
+		};
+
+		inline Float8 operator+(Float8 a, Float8 b) { return _mm256_add_ps(a.v, b.v); }
+		inline Float8 operator-(Float8 a, Float8 b) { return _mm256_sub_ps(a.v, b.v); }
+		inline Float8 operator*(Float8 a, Float8 b) { return _mm256_mul_ps(a.v, b.v); }
+		inline Float8 Min(Float8 a, Float8 b) { return _mm256_min_ps(a.v, b.v); }
+		inline Float8 Sqrt(Float8 a) { return _mm256_sqrt_ps(a.v); }
+		inline Float8 Round(Float8 a) { return _mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		inline Mask8 operator<(Float8 a, Float8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+		inline Mask8 operator>=(Float8 a, Float8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) }; }
+
+		inline Mask8 operator&(Mask8 a, Mask8 b) { return { _mm256_and_ps(a.v, b.v) }; }
+		inline Mask8 operator|(Mask8 a, Mask8 b) { return { _mm256_or_ps(a.v, b.v) }; }
+		inline Mask8 AndNot(Mask8 a, Mask8 b) { return { _mm256_andnot_ps(b.v, a.v) }; }
+		inline bool Any(Mask8 m) { return _mm256_movemask_ps(m.v) != 0; }
+		inline int Bits(Mask8 m) { return _mm256_movemask_ps(m.v); }
+		inline Float8 Select(Mask8 m, Float8 a, Float8 b) { return _mm256_blendv_ps(b.v, a.v, m.v); }
+#endif
+
+#ifdef __AVX512F__
+		struct Mask16 {
+			__mmask16 v;
+		};
+
+		struct Float16 {
+			typedef Mask16 Mask;
+			static const int Width = 16;
+
+			__m512 v;
+
+			Float16() {}
+			Float16(__m512 v) : v(v) {}
+			Float16(float f) : v(_mm512_set1_ps(f)) {}
+
+			static Float16 Load(const float* p) { return _mm512_load_ps(p); }
+			void Store(float* p) const { _mm512_store_ps(p, v); }
+		};
+
+		inline Float16 operator+(Float16 a, Float16 b) { return _mm512_add_ps(a.v, b.v); }
+		inline Float16 operator-(Float16 a, Float16 b) { return _mm512_sub_ps(a.v, b.v); }
+		inline Float16 operator*(Float16 a, Float16 b) { return _mm512_mul_ps(a.v, b.v); }
+		inline Float16 Min(Float16 a, Float16 b) { return _mm512_min_ps(a.v, b.v); }
+		inline Float16 Sqrt(Float16 a) { return _mm512_sqrt_ps(a.v); }
+		inline Float16 Round(Float16 a) { return _mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		inline Mask16 operator<(Float16 a, Float16 b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ) }; }
+		inline Mask16 operator>=(Float16 a, Float16 b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_GE_OQ) }; }
+
+		inline Mask16 operator&(Mask16 a, Mask16 b) { return { (__mmask16)(a.v & b.v) }; }
+		inline Mask16 operator|(Mask16 a, Mask16 b) { return { (__mmask16)(a.v | b.v) }; }
+		inline Mask16 AndNot(Mask16 a, Mask16 b) { return { (__mmask16)(a.v & ~b.v) }; }
+		inline bool Any(Mask16 m) { return m.v != 0; }
+		inline int Bits(Mask16 m) { return m.v; }
+		inline Float16 Select(Mask16 m, Float16 a, Float16 b) { return _mm512_mask_blend_ps(m.v, b.v, a.v); }
+#endif
+
+		//sin() for any of the wrappers, within about 1e-7 of std::sin() while x stays in Round()'s range. x is taken to the nearest multiple
+		//of pi, in two parts so the reduction stays exact, and what's left goes through the Taylor series up to x^11
+		template<class F>
+		inline F Sin(F x) {
+			F k = Round(x * F(0.318309886f));
+			F r = x - k * F(3.140625f) - k * F(9.67653589793e-4f);
+			F r2 = r * r;
+			F p = F(-2.50521084e-8f);
+			p = p * r2 + F(2.75573192e-6f);
+			p = p * r2 + F(-1.98412698e-4f);
+			p = p * r2 + F(8.33333333e-3f);
+			p = p * r2 + F(-1.66666667e-1f);
+			F s = r + r * r2 * p;
+			//Odd multiples of pi flip the sign, h is a whole number or a half for them
+			F h = k * F(0.5f);
+			F f = h - Round(h);
+			return s * (F(1.f) - F(8.f) * f * f);
+		}
+	}
+}
@@ -0,0 +1,214 @@
+#include "TileScheduler.h"
+
+#include "../Maths.h"
+#include "../Timer.h"
+
+namespace marcher {
+	namespace cpu {
+		TileScheduler::TileScheduler(unsigned int threadCount)
+			: m_tileCount(0), m_cellsX(0), m_cellsY(0), m_renderTile(nullptr), m_region(), m_frame(0), m_running(0), m_quit(false) {
+			threadCount = glm::max(threadCount, 1u);
+			for (unsigned int i = 0; i < threadCount; i++)
+				m_queues.push_back(std::unique_ptr<Queue>(new Queue()));
+			m_stats.resize(threadCount);
+			for (unsigned int i = 1; i < threadCount; i++)
+				m_threads.push_back(std::thread(&TileScheduler::WorkerLoop, this, i));
+		}
+
+		TileScheduler::~TileScheduler() {
+			{
+				std::lock_guard<std::mutex> lock(m_frameLock);
+				m_quit = true;
+			}
+			m_frameStart.notify_all();
+			for (size_t i = 0; i < m_threads.size(); i++)
+				m_threads[i].join();
+		}
+
+		void TileScheduler::Run(int width, int height, const TileFunction& renderTile) {
+			Tile region = { 0, 0, width, height };
+			Run(region, renderTile);
+		}
+
+		void TileScheduler::Run(const Tile& region, const TileFunction& renderTile) {
+			//Tiles and costs are kept relative to the region, they're only moved into place when handed out
+			Timer frameTimer;
+			m_region = region;
+			BuildTiles(region.Width, region.Height);
+			m_stats.assign(m_queues.size(), ThreadStats());
+
+			{
+				std::lock_guard<std::mutex> lock(m_frameLock);
+				m_renderTile = &renderTile;
+				m_running = (unsigned int)m_threads.size();
+				m_frame++;
+			}
+			m_frameStart.notify_all();
+
+			Work(0);
+
+			{
+				std::unique_lock<std::mutex> lock(m_frameLock);
+				m_frameDone.wait(lock, [this]() { return m_running == 0; });
+				m_renderTile = nullptr;
+			}
+
+			float frameSeconds = frameTimer.CurrentTime<float>();
+			for (size_t i = 0; i < m_stats.size(); i++)
+				m_stats[i].IdleSeconds = glm::max(frameSeconds - m_stats[i].BusySeconds, 0.f);
+
+			m_cellCost.swap(m_nextCellCost);
+			std::fill(m_nextCellCost.begin(), m_nextCellCost.end(), 0ull);
+		}
+
+		void TileScheduler::BuildTiles(int width, int height) {
+			int cellsX = (width + CellSize - 1) / CellSize;
+			int cellsY = (height + CellSize - 1) / CellSize;
+			if (cellsX != m_cellsX || cellsY != m_cellsY) {
+				//Without a previous frame of the same size every cell is assumed to cost the same
+				m_cellsX = cellsX;
+				m_cellsY = cellsY;
+				m_cellCost.assign((size_t)cellsX * cellsY, 1ull);
+				m_nextCellCost.assign((size_t)cellsX * cellsY, 0ull);
+			}
+
+			unsigned long long total = 0;
+			for (size_t i = 0; i < m_cellCost.size(); i++)
+				total += m_cellCost[i];
+			//Enough tiles per thread that stealing can even out whatever last frame's costs got wrong
+			unsigned long long target = glm::max(total / (m_queues.size() * 8), 1ull);
+
+			std::vector<Tile> tiles;
+			for (int y = 0; y < height; y += MaxTileSize) {
+				for (int x = 0; x < width; x += MaxTileSize) {
+					Tile tile = { x, y, glm::min(MaxTileSize, width - x), glm::min(MaxTileSize, height - y) };
+					SplitTile(tile, target, tiles);
+				}
+			}
+			m_tileCount = tiles.size();
+
+			//Each queue gets a contiguous run of tiles worth about the same, so workers start on nearby pixels
+			std::vector<unsigned long long> costs(tiles.size());
+			unsigned long long tileTotal = 0;
+			for (size_t i = 0; i < tiles.size(); i++) {
+				costs[i] = TileCost(tiles[i]);
+				tileTotal += costs[i];
+			}
+
+			size_t queueCount = m_queues.size();
+			unsigned long long accumulated = 0;
+			for (size_t i = 0; i < tiles.size(); i++) {
+				size_t queue = (size_t)((double)accumulated / ((double)tileTotal + 1) * queueCount);
+				m_queues[glm::min(queue, queueCount - 1)]->Tiles.push_back(tiles[i]);
+				accumulated += costs[i];
+			}
+		}
+
+		void TileScheduler::SplitTile(const Tile& tile, unsigned long long target, std::vector<Tile>& tiles) const {
+			bool splitX = tile.Width > MinTileSize;
+			bool splitY = tile.Height > MinTileSize;
+			if ((!splitX && !splitY) || TileCost(tile) <= target) {
+				tiles.push_back(tile);
+				return;
+			}
+
+			//Halves are kept to multiples of MinTileSize
+			int halfWidth = splitX ? ((tile.Width / 2 + MinTileSize - 1) / MinTileSize) * MinTileSize : tile.Width;
+			int halfHeight = splitY ? ((tile.Height / 2 + MinTileSize - 1) / MinTileSize) * MinTileSize : tile.Height;
+			for (int y = 0; y < tile.Height; y += halfHeight) {
+				for (int x = 0; x < tile.Width; x += halfWidth) {
+					Tile part = { tile.X + x, tile.Y + y, glm::min(halfWidth, tile.Width - x), glm::min(halfHeight, tile.Height - y) };
+					SplitTile(part, target, tiles);
+				}
+			}
+		}
+
+		unsigned long long TileScheduler::TileCost(const Tile& tile) const {
+			//Cells that the tile only partially covers count by the fraction covered
+			double cost = 0.0;
+			for (int cy = tile.Y / CellSize; cy <= (tile.Y + tile.Height - 1) / CellSize; cy++) {
+				int overlapY = glm::min(tile.Y + tile.Height, (cy + 1) * CellSize) - glm::max(tile.Y, cy * CellSize);
+				for (int cx = tile.X / CellSize; cx <= (tile.X + tile.Width - 1) / CellSize; cx++) {
+					int overlapX = glm::min(tile.X + tile.Width, (cx + 1) * CellSize) - glm::max(tile.X, cx * CellSize);
+					cost += (double)m_cellCost[(size_t)cy * m_cellsX + cx] * (overlapX * overlapY) / (CellSize * CellSize);
+				}
+			}
+			return (unsigned long long)cost;
+		}
+
+		void TileScheduler::RecordCost(const Tile& tile, unsigned long long steps) {
+			double perPixel = (double)steps / (tile.Width * tile.Height);
+			std::lock_guard<std::mutex> lock(m_costLock);
+			for (int cy = tile.Y / CellSize; cy <= (tile.Y + tile.Height - 1) / CellSize; cy++) {
+				int overlapY = glm::min(tile.Y + tile.Height, (cy + 1) * CellSize) - glm::max(tile.Y, cy * CellSize);
+				for (int cx = tile.X / CellSize; cx <= (tile.X + tile.Width - 1) / CellSize; cx++) {
+					int overlapX = glm::min(tile.X + tile.Width, (cx + 1) * CellSize) - glm::max(tile.X, cx * CellSize);
+					m_nextCellCost[(size_t)cy * m_cellsX + cx] += (unsigned long long)(perPixel * overlapX * overlapY) + 1;
+				}
+			}
+		}
+
+		void TileScheduler::WorkerLoop(unsigned int index) {
+			unsigned long long lastFrame = 0;
+			while (true) {
+				{
+					std::unique_lock<std::mutex> lock(m_frameLock);
+					m_frameStart.wait(lock, [&]() { return m_quit || m_frame != lastFrame; });
+					if (m_quit)
+						return;
+					lastFrame = m_frame;
+				}
+
+				Work(index);
+
+				{
+					std::lock_guard<std::mutex> lock(m_frameLock);
+					m_running--;
+				}
+				m_frameDone.notify_one();
+			}
+		}
+
+		void TileScheduler::Work(unsigned int index) {
+			ThreadStats& stats = m_stats[index];
+			Tile tile;
+			bool stolen;
+			while (NextTile(index, tile, stolen)) {
+				Timer timer;
+				Tile placed = { tile.X + m_region.X, tile.Y + m_region.Y, tile.Width, tile.Height };
+				unsigned long long steps = (*m_renderTile)(placed);
+				stats.BusySeconds += timer.CurrentTime<float>();
+				stats.Tiles++;
+				if (stolen)
+					stats.StolenTiles++;
+				RecordCost(tile, steps);
+			}
+		}
+
+		bool TileScheduler::NextTile(unsigned int index, Tile& tile, bool& stolen) {
+			{
+				Queue& own = *m_queues[index];
+				std::lock_guard<std::mutex> lock(own.Lock);
+				if (!own.Tiles.empty()) {
+					tile = own.Tiles.front();
+					own.Tiles.pop_front();
+					stolen = false;
+					return true;
+				}
+			}
+
+			//No tiles are added during a frame, so once every queue is empty the frame is done for this worker
+			for (size_t i = 1; i < m_queues.size(); i++) {
+				Queue& victim = *m_queues[(index + i) % m_queues.size()];
+				std::lock_guard<std::mutex> lock(victim.Lock);
+				if (!victim.Tiles.empty()) {
+					tile = victim.Tiles.back();
+					victim.Tiles.pop_back();
+					stolen = true;
+					return true;
+				}
+			}
+			return false;
+		}
+	}
+}
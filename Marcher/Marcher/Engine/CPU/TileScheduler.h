@@ -0,0 +1,89 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "RenderTypes.h"
+
+/*
+	The TileScheduler spreads a frame over a pool of worker threads.
+	Tiles are sized from the step counts each part of the screen took last frame: expensive regions are split into small tiles and cheap ones are merged into big ones.
+	Every worker owns a queue seeded with a contiguous run of roughly equal cost, and steals from the back of the others' queues once its own runs dry.
+*/
+
+namespace marcher {
+	namespace cpu {
+		//A rectangle of pixels, Y counts rows from the top of the image
+		struct Tile {
+			int X, Y, Width, Height;
+		};
+
+		struct ThreadStats {
+			float BusySeconds = 0.f, IdleSeconds = 0.f;
+			int Tiles = 0, StolenTiles = 0;
+		};
+
+		class TileScheduler {
+		public:
+			//Renders a tile and returns how many march steps it took
+			typedef std::function<unsigned long long(const Tile&)> TileFunction;
+
+			//The calling thread of Run() is worker 0, so threadCount - 1 threads get created
+			TileScheduler(unsigned int threadCount);
+			~TileScheduler();
+
+			//Renders a whole frame and returns once every tile is done
+			void Run(int width, int height, const TileFunction& renderTile);
+			//Only renders the given region of a frame, tiles are still passed in frame coordinates
+			void Run(const Tile& region, const TileFunction& renderTile);
+
+			unsigned int ThreadCount() const { return (unsigned int)m_queues.size(); }
+			//Stats of the last Run(), one per worker
+			const std::vector<ThreadStats>& GetThreadStats() const { return m_stats; }
+			//How many tiles the last Run() was split into
+			size_t TileCount() const { return m_tileCount; }
+
+			//Cost is tracked per cell of this many pixels, tiles are never merged past MaxTileSize or split below MinTileSize
+			static const int CellSize = 16;
+			static const int MaxTileSize = 64;
+			static const int MinTileSize = 8;
+
+		private:
+			struct Queue {
+				std::mutex Lock;
+				std::deque<Tile> Tiles;
+			};
+
+			void BuildTiles(int width, int height);
+			void SplitTile(const Tile& tile, unsigned long long target, std::vector<Tile>& tiles) const;
+			unsigned long long TileCost(const Tile& tile) const;
+			void RecordCost(const Tile& tile, unsigned long long steps);
+
+			void WorkerLoop(unsigned int index);
+			void Work(unsigned int index);
+			bool NextTile(unsigned int index, Tile& tile, bool& stolen);
+
+			std::vector<std::unique_ptr<Queue>> m_queues;
+			std::vector<std::thread> m_threads;
+			std::vector<ThreadStats> m_stats;
+			size_t m_tileCount;
+
+			//Step counts of the last frame, per cell
+			std::vector<unsigned long long> m_cellCost, m_nextCellCost;
+			std::mutex m_costLock;
+			int m_cellsX, m_cellsY;
+
+			const TileFunction* m_renderTile;
+			Tile m_region;
+			std::mutex m_frameLock;
+			std::condition_variable m_frameStart, m_frameDone;
+			unsigned long long m_frame;
+			unsigned int m_running;
+			bool m_quit;
+		};
+	}
+}
@@ -0,0 +1,84 @@
+#include "AOBaker.h"
+
+#include <cmath>
+
+namespace marcher {
+	AOBaker::AOBaker()
+		: m_texture(0), m_framebuffer(0), m_maxBytes(0), m_slice(-1), m_resolution(1),
+		m_min(0.f), m_max(0.f), m_sceneMin(0.f), m_sceneMax(0.f), m_extent(0.f) {
+		glGenTextures(1, &m_texture);
+		glBindTexture(GL_TEXTURE_3D, m_texture);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_3D, 0);
+		glGenFramebuffers(1, &m_framebuffer);
+	}
+
+	void AOBaker::Update(const glm::vec3& sceneMin, const glm::vec3& sceneMax, float extent, size_t maxBytes) {
+		if (m_slice >= 0 && sceneMin == m_sceneMin && sceneMax == m_sceneMax && extent == m_extent && maxBytes == m_maxBytes)
+			return;
+		m_sceneMin = sceneMin;
+		m_sceneMax = sceneMax;
+		m_extent = extent;
+		m_maxBytes = maxBytes;
+		m_slice = 0;
+
+		m_min = glm::max(sceneMin, glm::vec3(-extent));
+		m_max = glm::max(glm::min(sceneMax, glm::vec3(extent)), m_min + glm::vec3(1e-3f));
+		glm::vec3 size = m_max - m_min;
+		//Rounding the sides up can go a little over the budget, so the voxel count is taken a bit under it
+		double voxels = glm::max((double)maxBytes / sizeof(glm::uint16) * 0.9, 8.0);
+		float voxel = (float)std::cbrt((double)size.x * size.y * size.z / voxels);
+		glm::ivec3 resolution = glm::clamp(glm::ivec3(glm::ceil(size / voxel)), glm::ivec3(2), glm::ivec3(MaxResolution));
+		if (resolution != m_resolution) {
+			m_resolution = resolution;
+			glBindTexture(GL_TEXTURE_3D, m_texture);
+			glTexImage3D(GL_TEXTURE_3D, 0, GL_R16F, resolution.x, resolution.y, resolution.z, 0, GL_RED, GL_FLOAT, nullptr);
+			glBindTexture(GL_TEXTURE_3D, 0);
+		}
+	}
+
+	void AOBaker::Invalidate() {
+		m_slice = -1;
+	}
+
+	bool AOBaker::Bake(std::shared_ptr<Shader> shader, GLuint VAO) {
+		if (m_slice < 0 || Ready())
+			return Ready();
+
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+		glViewport(0, 0, m_resolution.x, m_resolution.y);
+		shader->SendUniform("ScreenSize", glm::vec2(m_resolution.x, m_resolution.y));
+		shader->SendUniform("AOVolumeMin", m_min);
+		shader->SendUniform("AOVolumeMax", m_max);
+		shader->SendUniform("AOVolumeResolution", glm::vec3(m_resolution));
+		shader->SendUniform("AOBake", 1);
+		glBindVertexArray(VAO);
+
+		//Each slice is a layer of the volume drawn like a frame
+		int slices = glm::max(VoxelsPerFrame / (m_resolution.x * m_resolution.y), 1);
+		for (int end = glm::min(m_slice + slices, m_resolution.z); m_slice < end; m_slice++) {
+			glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_texture, 0, m_slice);
+			shader->SendUniform("AOBakeSlice", m_slice);
+			glDrawArrays(GL_TRIANGLES, 0, 6);
+		}
+
+		shader->SendUniform("AOBake", 0);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		return Ready();
+	}
+
+	void AOBaker::BindTexture(int unit) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_3D, m_texture);
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	AOBaker::~AOBaker() {
+		glDeleteFramebuffers(1, &m_framebuffer);
+		glDeleteTextures(1, &m_texture);
+	}
+}
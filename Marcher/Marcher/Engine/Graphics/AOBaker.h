@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <memory>
+
+#include "../Maths.h"
+#include "Shader.h"
+
+/*
+	Bakes ambient occlusion into a 3D texture over the scene bounds. Each voxel holds the occlusion of the surface nearest to it,
+	so a trilinear fetch at a hit replaces the AO taps. Like the shadow map it's baked a few slices a frame,
+	and the main shader keeps tapping the scene itself until it's done.
+*/
+
+namespace marcher {
+	class AOBaker {
+	public:
+		AOBaker();
+
+		//Starts a new bake if the region or budget changed, the volume covers sceneMin to sceneMax within extent of the origin.
+		//Its voxels are cubes, as many as fit in maxBytes of R16F, and no side gets more than MaxResolution of them
+		void Update(const glm::vec3& sceneMin, const glm::vec3& sceneMax, float extent, size_t maxBytes = DefaultBytes);
+		//Forgets the volume, for when the scene itself changed
+		void Invalidate();
+		//Bakes the next VoxelsPerFrame voxels worth of slices. shader must be the bound main shader with every render uniform sent,
+		//its viewport and framebuffer are changed. Returns true once the volume is complete
+		bool Bake(std::shared_ptr<Shader> shader, GLuint VAO);
+
+		bool Ready() const { return m_slice >= m_resolution.z; }
+		float Progress() const { return glm::clamp((float)m_slice / m_resolution.z, 0.f, 1.f); }
+		void BindTexture(int unit);
+		const glm::vec3& Min() const { return m_min; }
+		const glm::vec3& Max() const { return m_max; }
+
+		~AOBaker();
+
+		static const int VoxelsPerFrame = 1 << 19;
+		//About 160^3 voxels
+		static const size_t DefaultBytes = 8 << 20;
+		static const int MaxResolution = 512;
+
+	private:
+		GLuint m_texture, m_framebuffer;
+		size_t m_maxBytes;
+		int m_slice;
+		glm::ivec3 m_resolution;
+		glm::vec3 m_min, m_max;
+		glm::vec3 m_sceneMin, m_sceneMax;
+		float m_extent;
+	};
+}
@@ -0,0 +1,79 @@
+#include "Accumulator.h"
+
+#include "../Sampling.h"
+
+namespace marcher {
+	namespace {
+		//Blended additively, so alpha ends up counting the samples
+		const char* AddFS = "#version 330 core\n"
+			"out vec4 FragColor;\n"
+			"uniform sampler2D Frame;\n"
+			"\n"
+			"void main() {\n"
+			"    FragColor = vec4(texelFetch(Frame, ivec2(gl_FragCoord.xy), 0).rgb, 1);\n"
+			"}";
+
+		const char* PresentFS = "#version 330 core\n"
+			"out vec4 FragColor;\n"
+			"uniform sampler2D Sum;\n"
+			"uniform vec2 WindowSize;\n"
+			"\n"
+			"void main() {\n"
+			"    vec4 sum = texture(Sum, gl_FragCoord.xy / WindowSize);\n"
+			"    FragColor = vec4(sum.rgb / max(sum.a, 1.0), 1);\n"
+			"}";
+	}
+
+	Accumulator::Accumulator()
+		: m_add(std::make_shared<Shader>()), m_present(std::make_shared<Shader>()), m_sum({ GL_RGBA32F }, GL_LINEAR), m_samples(0) {
+		m_add->AddShaderString(FullscreenVS, ShaderType::VERTEX_SHADER, "Accumulate VS");
+		m_add->AddShaderString(AddFS, ShaderType::FRAGMENT_SHADER, "Accumulate FS");
+		m_add->Compile();
+		m_present->AddShaderString(FullscreenVS, ShaderType::VERTEX_SHADER, "Accumulate VS");
+		m_present->AddShaderString(PresentFS, ShaderType::FRAGMENT_SHADER, "Present FS");
+		m_present->Compile();
+		glGenVertexArrays(1, &m_VAO);
+	}
+
+	glm::vec2 Accumulator::NextOffset() const {
+		return SampleOffset(m_samples, MaxSamples);
+	}
+
+	void Accumulator::Add(RenderTarget& frame) {
+		if (frame.Width() != m_sum.Width() || frame.Height() != m_sum.Height()) {
+			m_sum.Resize(frame.Width(), frame.Height());
+			m_samples = 0;
+		}
+		m_sum.Bind();
+		if (m_samples == 0) {
+			glClearColor(0.f, 0.f, 0.f, 0.f);
+			glClear(GL_COLOR_BUFFER_BIT);
+		}
+
+		m_add->Bind();
+		frame.BindTexture(0);
+		m_add->SendUniform("Frame", 0);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_ONE, GL_ONE);
+		glBindVertexArray(m_VAO);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		glBindVertexArray(0);
+		glDisable(GL_BLEND);
+		m_samples++;
+	}
+
+	void Accumulator::Present(int width, int height) {
+		RenderTarget::Unbind(width, height);
+		m_present->Bind();
+		m_sum.BindTexture(0);
+		m_present->SendUniform("Sum", 0);
+		m_present->SendUniform("WindowSize", glm::vec2(width, height));
+		glBindVertexArray(m_VAO);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		glBindVertexArray(0);
+	}
+
+	Accumulator::~Accumulator() {
+		glDeleteVertexArrays(1, &m_VAO);
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <memory>
+
+#include "../Maths.h"
+#include "Shader.h"
+#include "RenderTarget.h"
+
+/*
+	Progressive supersampling for views that hold still: each frame is one more jittered sample per pixel,
+	summed into a float buffer and shown as the running average.
+*/
+
+namespace marcher {
+	class Accumulator {
+	public:
+		Accumulator();
+
+		//Starts over with the next Add()
+		void Reset() { m_samples = 0; }
+		//Adds the first texture of frame as one more sample, starting over if its size changed
+		void Add(RenderTarget& frame);
+		//Draws the average so far onto the window's framebuffer, stretched to width*height. Leaves the present shader bound
+		void Present(int width, int height);
+
+		int Samples() const { return m_samples; }
+		//Sub-pixel offset the next sample should be rendered at, from 0 to 1 in both axes
+		glm::vec2 NextOffset() const;
+		//Past this many samples the average doesn't visibly change, so there's nothing left to add
+		bool Converged() const { return m_samples >= MaxSamples; }
+
+		static const int MaxSamples = 256;
+
+		~Accumulator();
+
+	private:
+		std::shared_ptr<Shader> m_add, m_present;
+		RenderTarget m_sum;
+		GLuint m_VAO;
+		int m_samples;
+	};
+}
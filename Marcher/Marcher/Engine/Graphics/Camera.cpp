@@ -7,26 +7,37 @@ namespace marcher {
 	}
 
 	void Camera::Update(std::shared_ptr<Shader> shader, float aspectRatio, glm::vec4 viewport) {
+		Update(aspectRatio, viewport);
+		SendUniforms(shader);
+
+		/*printf("TL: %f %f %f \n", TopLeft.x, TopLeft.y, TopLeft.z);
+		printf("TR: %f %f %f \n", TopRight.x, TopRight.y, TopRight.z);
+		printf("BL: %f %f %f \n", BottomLeft.x, BottomLeft.y, BottomLeft.z);
+		printf("BR: %f %f %f \n", BottomRight.x, BottomRight.y, BottomRight.z);*/
+	}
+
+	void Camera::Update(float aspectRatio, glm::vec4 viewport) {
 		View = glm::lookAt(Position, Target, glm::vec3(0, 1, 0));
 		Projection = glm::perspective(glm::radians(FOV), aspectRatio, 0.1f, 100.f);
-		VP = View * Projection;
+		VP = Projection * View;
 
-		glm::vec3 TopLeft = glm::unProject(glm::vec3(0, 0, 0), View, Projection, viewport);
-		glm::vec3 TopRight = glm::unProject(glm::vec3(viewport.z, 0, 0), View, Projection, viewport);
-		glm::vec3 BottomLeft = glm::unProject(glm::vec3(0, viewport.w, 0), View, Projection, viewport);
-		glm::vec3 BottomRight = glm::unProject(glm::vec3(viewport.z, viewport.w, 0), View, Projection, viewport);
+		TopLeft = glm::unProject(glm::vec3(0, 0, 0), View, Projection, viewport);
+		TopRight = glm::unProject(glm::vec3(viewport.z, 0, 0), View, Projection, viewport);
+		BottomLeft = glm::unProject(glm::vec3(0, viewport.w, 0), View, Projection, viewport);
+		BottomRight = glm::unProject(glm::vec3(viewport.z, viewport.w, 0), View, Projection, viewport);
+	}
 
+	glm::vec3 Camera::NearPlanePoint(glm::vec2 relative) const {
+		return glm::mix(glm::mix(TopLeft, TopRight, relative.x), glm::mix(BottomLeft, BottomRight, relative.x), relative.y);
+	}
+
+	void Camera::SendUniforms(std::shared_ptr<Shader> shader, glm::vec2 from, glm::vec2 to) const {
 		shader->SendUniform("MainCamera.Position", Position);
 		shader->SendUniform("MainCamera.Target", Target);
-		shader->SendUniform("MainCamera.TopLeft", TopLeft);
-		shader->SendUniform("MainCamera.TopRight", TopRight);
-		shader->SendUniform("MainCamera.BottomLeft", BottomLeft);
-		shader->SendUniform("MainCamera.BottomRight", BottomRight);
-
-		/*printf("TL: %f %f %f \n", TopLeft.x, TopLeft.y, TopLeft.z);
-		printf("TR: %f %f %f \n", TopRight.x, TopRight.y, TopRight.z);
-		printf("BL: %f %f %f \n", BottomLeft.x, BottomLeft.y, BottomLeft.z);
-		printf("BR: %f %f %f \n", BottomRight.x, BottomRight.y, BottomRight.z);*/
+		shader->SendUniform("MainCamera.TopLeft", NearPlanePoint(glm::vec2(from.x, from.y)));
+		shader->SendUniform("MainCamera.TopRight", NearPlanePoint(glm::vec2(to.x, from.y)));
+		shader->SendUniform("MainCamera.BottomLeft", NearPlanePoint(glm::vec2(from.x, to.y)));
+		shader->SendUniform("MainCamera.BottomRight", NearPlanePoint(glm::vec2(to.x, to.y)));
 	}
 
 	Camera::~Camera() {
@@ -12,10 +12,18 @@ namespace marcher {
 		~Camera();
 
 		void Update(std::shared_ptr<Shader> shader, float aspectRatio, glm::vec4 viewport);
+		//Only computes the matrices and near plane corners, used by renderers that don't go through a shader
+		void Update(float aspectRatio, glm::vec4 viewport);
+
+		//The point on the near plane that CalculateFragRay() in HeaderFS picks for a relative screen position
+		glm::vec3 NearPlanePoint(glm::vec2 relative) const;
+		//Sends the camera uniforms with the corners narrowed down to the part of the screen between from and to (relative, gl_FragCoord orientation)
+		void SendUniforms(std::shared_ptr<Shader> shader, glm::vec2 from = glm::vec2(0), glm::vec2 to = glm::vec2(1)) const;
 
 		float FOV;
 
 		glm::mat4 View, Projection, VP;
 		glm::vec3 Position, Target;
+		glm::vec3 TopLeft, TopRight, BottomLeft, BottomRight;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include "CheckerboardResolver.h"
+
+namespace marcher {
+	namespace {
+		const char* ResolveFS = "#version 330 core\n"
+			"layout(location = 0) out vec4 FragColor;\n"
+			"layout(location = 1) out vec4 HitPosition;\n"
+			"\n"
+			"struct Camera {\n"
+			"    vec3 Position, Target;\n"
+			"    vec3 TopLeft, TopRight, BottomLeft, BottomRight;\n"
+			"};\n"
+			"\n"
+			"uniform Camera MainCamera;\n"
+			"uniform vec2 ScreenSize;\n"
+			"uniform sampler2D MarchedColor, MarchedPositions, LastColor, LastPositions;\n"
+			"uniform bool LastValid;\n"
+			"uniform mat4 LastVP;\n"
+			"uniform int Parity;\n"
+			"\n"
+			"// Finds the color the last frame had at a world position, false if the last frame saw something else there\n"
+			"bool FromLastFrame(vec3 position, out vec3 color) {\n"
+			"    vec4 clip = LastVP * vec4(position, 1);\n"
+			"    if (!LastValid || clip.w <= 0) {\n"
+			"        return false;\n"
+			"    }\n"
+			"    vec2 uv = clip.xy / clip.w * 0.5 + 0.5;\n"
+			"    if (any(lessThan(uv, vec2(0))) || any(greaterThanEqual(uv, vec2(1)))) {\n"
+			"        return false;\n"
+			"    }\n"
+			"    ivec2 texel = ivec2(uv * textureSize(LastPositions, 0));\n"
+			"    vec4 last = texelFetch(LastPositions, texel, 0);\n"
+			"    if (last.w == 0 || distance(last.xyz, position) > 0.02 * distance(position, MainCamera.Position)) {\n"
+			"        return false;\n"
+			"    }\n"
+			"    color = texelFetch(LastColor, texel, 0).rgb;\n"
+			"    return true;\n"
+			"}\n"
+			"\n"
+			"void main() {\n"
+			"    ivec2 pixel = ivec2(gl_FragCoord.xy);\n"
+			"    if (((pixel.x + pixel.y + Parity) & 1) == 0) {\n"
+			"        FragColor = texelFetch(MarchedColor, pixel, 0);\n"
+			"        HitPosition = texelFetch(MarchedPositions, pixel, 0);\n"
+			"        return;\n"
+			"    }\n"
+			"\n"
+			"    vec2 RelScreenPos = gl_FragCoord.xy / ScreenSize;\n"
+			"    vec3 TopPos = mix(MainCamera.TopLeft, MainCamera.TopRight, RelScreenPos.x);\n"
+			"    vec3 BottomPos = mix(MainCamera.BottomLeft, MainCamera.BottomRight, RelScreenPos.x);\n"
+			"    vec3 direction = normalize(mix(TopPos, BottomPos, RelScreenPos.y) - MainCamera.Position);\n"
+			"\n"
+			"    // Every direct neighbour was marched this frame. Each one that hit gives a guess at this pixel's depth, the closest guess the last frame agrees with wins\n"
+			"    ivec2 size = textureSize(MarchedColor, 0);\n"
+			"    ivec2 offsets[4] = ivec2[4](ivec2(-1, 0), ivec2(1, 0), ivec2(0, -1), ivec2(0, 1));\n"
+			"    vec3 average = vec3(0);\n"
+			"    float count = 0.0, bestDepth = 1e30, guessDepth = 1e30;\n"
+			"    vec3 best;\n"
+			"    for (int i = 0; i < 4; i++) {\n"
+			"        ivec2 neighbour = pixel + offsets[i];\n"
+			"        if (any(lessThan(neighbour, ivec2(0))) || any(greaterThanEqual(neighbour, size))) {\n"
+			"            continue;\n"
+			"        }\n"
+			"        average += texelFetch(MarchedColor, neighbour, 0).rgb;\n"
+			"        count += 1.0;\n"
+			"\n"
+			"        vec4 hit = texelFetch(MarchedPositions, neighbour, 0);\n"
+			"        if (hit.w == 0) {\n"
+			"            continue;\n"
+			"        }\n"
+			"        float depth = distance(hit.xyz, MainCamera.Position);\n"
+			"        guessDepth = min(guessDepth, depth);\n"
+			"        vec3 color;\n"
+			"        if (depth < bestDepth && FromLastFrame(MainCamera.Position + direction * depth, color)) {\n"
+			"            bestDepth = depth;\n"
+			"            best = color;\n"
+			"        }\n"
+			"    }\n"
+			"\n"
+			"    if (bestDepth < 1e30) {\n"
+			"        FragColor = vec4(best, 1);\n"
+			"        HitPosition = vec4(MainCamera.Position + direction * bestDepth, 0.25);\n"
+			"    }\n"
+			"    else {\n"
+			"        FragColor = vec4(average / max(count, 1.0), 1);\n"
+			"        HitPosition = guessDepth < 1e30 ? vec4(MainCamera.Position + direction * guessDepth, 0.25) : vec4(0);\n"
+			"    }\n"
+			"}";
+	}
+
+	CheckerboardResolver::CheckerboardResolver()
+		: m_shader(std::make_shared<Shader>()) {
+		m_shader->AddShaderString(FullscreenVS, ShaderType::VERTEX_SHADER, "Resolve VS");
+		m_shader->AddShaderString(ResolveFS, ShaderType::FRAGMENT_SHADER, "Resolve FS");
+		m_shader->Compile();
+		glGenVertexArrays(1, &m_VAO);
+	}
+
+	void CheckerboardResolver::Resolve(RenderTarget& marched, RenderTarget& last, bool lastValid, const glm::mat4& lastVP, const Camera& camera, int parity, RenderTarget& out) {
+		out.Resize(marched.Width(), marched.Height());
+		out.Bind();
+
+		m_shader->Bind();
+		camera.SendUniforms(m_shader);
+		m_shader->SendUniform("ScreenSize", glm::vec2(marched.Width(), marched.Height()));
+		m_shader->SendUniform("LastValid", (int)lastValid);
+		m_shader->SendUniform("LastVP", lastVP);
+		m_shader->SendUniform("Parity", parity);
+
+		marched.BindTexture(0, 0);
+		marched.BindTexture(1, 1);
+		last.BindTexture(2, 0);
+		last.BindTexture(3, 1);
+		m_shader->SendUniform("MarchedColor", 0);
+		m_shader->SendUniform("MarchedPositions", 1);
+		m_shader->SendUniform("LastColor", 2);
+		m_shader->SendUniform("LastPositions", 3);
+
+		glBindVertexArray(m_VAO);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		glBindVertexArray(0);
+	}
+
+	CheckerboardResolver::~CheckerboardResolver() {
+		glDeleteVertexArrays(1, &m_VAO);
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <memory>
+
+#include "../Maths.h"
+#include "Shader.h"
+#include "Camera.h"
+#include "RenderTarget.h"
+
+/*
+	Fills in the half of the pixels that a checkerboard frame didn't march.
+	A missing pixel guesses its hit from the depths of its marched neighbours, projects that guess into the last frame with the last VP
+	and takes the color found there if the last frame saw the same point. Otherwise it averages its neighbours.
+*/
+
+namespace marcher {
+	class CheckerboardResolver {
+	public:
+		CheckerboardResolver();
+
+		//marched holds color and hit position of the pixels where (x + y + parity) is even, last is the previous resolved frame.
+		//Writes color and hit position of every pixel to out, reconstructed hits get a w of 0.25 so they aren't mistaken for marched ones.
+		//Leaves the resolve shader bound
+		void Resolve(RenderTarget& marched, RenderTarget& last, bool lastValid, const glm::mat4& lastVP, const Camera& camera, int parity, RenderTarget& out);
+
+		~CheckerboardResolver();
+
+	private:
+		std::shared_ptr<Shader> m_shader;
+		GLuint m_VAO;
+	};
+}
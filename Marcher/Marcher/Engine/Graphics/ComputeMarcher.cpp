@@ -0,0 +1,161 @@
+#include "ComputeMarcher.h"
+
+namespace marcher {
+	namespace {
+		//Appended to HeaderFS and the scene, which leave out their fragment entry point when COMPUTE_MARCH is defined
+		const char* ComputeMain = "\n"
+			"layout(local_size_x = 64) in;\n"
+			"\n"
+			"// NextPixel hands out pixels to the march phase, which pushes its hits onto LitQueue. NextLit hands those out to the light phase\n"
+			"layout(std430, binding = 0) buffer RayQueues {\n"
+			"    uint NextPixel;\n"
+			"    uint LitCount;\n"
+			"    uint NextLit;\n"
+			"    uint Padding;\n"
+			"    uint LitQueue[];\n"
+			"};\n"
+			"\n"
+			"layout(binding = 0, rgba8) uniform writeonly image2D FrameColor;\n"
+			"layout(binding = 1, rgba32f) uniform writeonly image2D FramePosition;\n"
+			"layout(binding = 2, rgba32f) uniform writeonly image2D MarchImage;\n"
+			"layout(binding = 3, rgba32f) uniform image2D PositionImage;\n"
+			"layout(binding = 4, rgba16f) uniform image2D SurfaceImage;\n"
+			"\n"
+			"// 0 marches the primary rays, 1 lights the hits the march phase queued\n"
+			"uniform int ComputePhase;\n"
+			"\n"
+			"// Pixels go out in 8x8 tiles, so the rays a warp has in flight stay close together\n"
+			"ivec2 QueuedPixel(uint index, int tilesX) {\n"
+			"    int tile = int(index / 64u), texel = int(index % 64u);\n"
+			"    return ivec2(tile % tilesX, tile / tilesX) * 8 + ivec2(texel % 8, texel / 8);\n"
+			"}\n"
+			"\n"
+			"// What the geometry pass does for a pixel, misses are finished here and hits are queued for lighting\n"
+			"void MarchPixel(ivec2 pixel) {\n"
+			"    StartDepth = 0.f;\n"
+			"    SDFCalls = 0;\n"
+			"    Grazing = 1e10;\n"
+			"    Material = 0;\n"
+			"\n"
+			"    Ray ray = CalculateRay(vec2(pixel) + 0.5);\n"
+			"    MarchInfo info;\n"
+			"    SDFCalls++;\n"
+			"    bool inside = SceneSDF(ray.Origin) < Epsilon;\n"
+			"    if (inside) {\n"
+			"        info = MarchInfo(false, -1.0, 0.0, ray.Origin, vec3(0), 0);\n"
+			"    }\n"
+			"    else {\n"
+			"        info = March(ray);\n"
+			"    }\n"
+			"#ifdef SCENE_MATERIAL\n"
+			"    if (info.Hit) {\n"
+			"        Material = SceneMaterial(info.Position);\n"
+			"    }\n"
+			"#endif\n"
+			"\n"
+			"    imageStore(MarchImage, pixel, vec4(info.Depth, info.Steps, Grazing, SDFCalls));\n"
+			"    imageStore(PositionImage, pixel, vec4(info.Position, info.Hit ? 1 : 0));\n"
+			"    imageStore(SurfaceImage, pixel, vec4(info.Normal, Material));\n"
+			"    imageStore(FramePosition, pixel, inside ? vec4(0) : vec4(info.Position, info.Hit ? 1 : 0));\n"
+			"    if (info.Hit) {\n"
+			"        LitQueue[atomicAdd(LitCount, 1u)] = uint(pixel.x) | (uint(pixel.y) << 16);\n"
+			"    }\n"
+			"    else {\n"
+			"        imageStore(FrameColor, pixel, inside ? vec4(0, 0, 0, 1) : vec4(Shade(ray, info), 1));\n"
+			"    }\n"
+			"}\n"
+			"\n"
+			"// What the lighting pass does for a hit, from what the march phase stored\n"
+			"void LightPixel(ivec2 pixel) {\n"
+			"    vec4 position = imageLoad(PositionImage, pixel);\n"
+			"    vec4 surface = imageLoad(SurfaceImage, pixel);\n"
+			"    Material = int(surface.w);\n"
+			"\n"
+			"    Ray ray = CalculateRay(vec2(pixel) + 0.5);\n"
+			"    MarchInfo info = MarchInfo(true, distance(ray.Origin, position.xyz), 0.0, position.xyz, surface.xyz, 0);\n"
+			"    imageStore(FrameColor, pixel, vec4(Shade(ray, info), 1));\n"
+			"}\n"
+			"\n"
+			"void main() {\n"
+			"    Epsilon = EPSILON;\n"
+			"    MarchSteps = MAX_MARCHING_STEPS;\n"
+			"    UseShadows = ShadowsEnabled;\n"
+			"\n"
+			"    // Each thread keeps taking the next item off its queue until there are none left, whatever the rest of its warp is doing\n"
+			"    if (ComputePhase == 0) {\n"
+			"        ivec2 size = ivec2(ScreenSize);\n"
+			"        int tilesX = (size.x + 7) / 8;\n"
+			"        uint count = uint(tilesX * ((size.y + 7) / 8) * 64);\n"
+			"        for (uint index = atomicAdd(NextPixel, 1u); index < count; index = atomicAdd(NextPixel, 1u)) {\n"
+			"            ivec2 pixel = QueuedPixel(index, tilesX);\n"
+			"            if (all(lessThan(pixel, size))) {\n"
+			"                MarchPixel(pixel);\n"
+			"            }\n"
+			"        }\n"
+			"    }\n"
+			"    else {\n"
+			"        uint count = LitCount;\n"
+			"        for (uint slot = atomicAdd(NextLit, 1u); slot < count; slot = atomicAdd(NextLit, 1u)) {\n"
+			"            uint queued = LitQueue[slot];\n"
+			"            LightPixel(ivec2(queued & 0xFFFFu, queued >> 16));\n"
+			"        }\n"
+			"    }\n"
+			"}\n";
+	}
+
+	ComputeMarcher::ComputeMarcher()
+		: m_queues(0), m_capacity(0) {
+		glGenBuffers(1, &m_queues);
+	}
+
+	bool ComputeMarcher::Supported() {
+		return GLAD_GL_VERSION_4_3 != 0;
+	}
+
+	std::shared_ptr<Shader> ComputeMarcher::BuildShader(const std::string& fragmentSource) {
+		//Whatever the scene defined after #version stays, only the version and the entry point change
+		std::string source = fragmentSource;
+		source.replace(0, source.find('\n'), "#version 430 core\n#define COMPUTE_MARCH");
+		source += ComputeMain;
+
+		std::shared_ptr<Shader> shader = std::make_shared<Shader>();
+		shader->AddShaderString(source, ShaderType::COMPUTE_SHADER, "Compute March");
+		shader->Compile();
+		return shader;
+	}
+
+	void ComputeMarcher::Render(std::shared_ptr<Shader> shader, RenderTarget& frame, GBuffer& gbuffer, const GeometryState& state) {
+		int tiles = ((state.Size.x + 7) / 8) * ((state.Size.y + 7) / 8);
+		int pixels = state.Size.x * state.Size.y;
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_queues);
+		if (pixels > m_capacity) {
+			m_capacity = pixels;
+			glBufferData(GL_SHADER_STORAGE_BUFFER, (4 + (GLsizeiptr)pixels) * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+		}
+		//Only the counters start over, the queue is overwritten as it fills
+		glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, 4 * sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_queues);
+
+		frame.Resize(state.Size.x, state.Size.y);
+		frame.BindImage(0, 0, GL_WRITE_ONLY);
+		frame.BindImage(1, 1, GL_WRITE_ONLY);
+		gbuffer.BindImages(state, 2);
+
+		GLuint groups = (GLuint)glm::min((tiles * 64 + GroupSize - 1) / GroupSize, MaxGroups);
+		shader->SendUniform("ComputePhase", 0);
+		glDispatchCompute(groups, 1, 1);
+		//The light phase reads the hits and the queue the march phase wrote
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		shader->SendUniform("ComputePhase", 1);
+		glDispatchCompute(groups, 1, 1);
+		//Everything after this samples, blends over or blits what got written
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	ComputeMarcher::~ComputeMarcher() {
+		glDeleteBuffers(1, &m_queues);
+	}
+}
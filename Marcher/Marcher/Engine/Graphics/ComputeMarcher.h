@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <memory>
+#include <string>
+
+#include "../Maths.h"
+#include "Shader.h"
+#include "RenderTarget.h"
+#include "GBuffer.h"
+
+/*
+	Marches the frame with a compute shader instead of the main shader's fragment passes. Needs OpenGL 4.3, without it the fragment path is all there is.
+	A fixed number of persistent threads keep taking the next 8x8 tile's pixels off a shared counter, so a thread that finishes a cheap ray
+	goes on to another one instead of waiting for the slowest ray of its warp. Hits are compacted into a second queue that a second dispatch
+	lights, so the shadow rays and AO taps run over full warps of hits rather than warps with holes where rays missed.
+	The program is built from the main shader's own source, with the same uniforms and the same scene.
+*/
+
+namespace marcher {
+	class ComputeMarcher {
+	public:
+		ComputeMarcher();
+
+		//Whether the context can run compute shaders at all
+		static bool Supported();
+		//Builds the compute program from the main shader's fragment source, check Linked() before using it
+		static std::shared_ptr<Shader> BuildShader(const std::string& fragmentSource);
+
+		//Marches and lights every pixel of state.Size. Colors and hit positions go to frame's textures like the lighting pass writes them,
+		//the march info into gbuffer like the geometry pass writes it. shader must be the bound compute program with every render uniform sent
+		void Render(std::shared_ptr<Shader> shader, RenderTarget& frame, GBuffer& gbuffer, const GeometryState& state);
+
+		~ComputeMarcher();
+
+		//Threads per group, and how many groups stay resident. Persistent threads only help while they all fit on the GPU at once,
+		//past that extra groups just queue up behind the others
+		static const int GroupSize = 64;
+		static const int MaxGroups = 256;
+
+	private:
+		GLuint m_queues;
+		//Pixels the queue buffer has room for
+		int m_capacity;
+	};
+}
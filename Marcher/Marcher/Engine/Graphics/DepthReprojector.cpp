@@ -0,0 +1,81 @@
+#include "DepthReprojector.h"
+
+namespace marcher {
+	namespace {
+		const char* ReprojectVS = "#version 330 core\n"
+			"uniform sampler2D HitPositions;\n"
+			"uniform int LastWidth;\n"
+			"uniform mat4 VP;\n"
+			"uniform vec3 CameraPosition, CameraForward;\n"
+			"uniform float NearDistance;\n"
+			"out float StartDepth;\n"
+			"\n"
+			"void main() {\n"
+			"    vec4 hit = texelFetch(HitPositions, ivec2(gl_VertexID % LastWidth, gl_VertexID / LastWidth), 0);\n"
+			"    float forward = dot(hit.xyz - CameraPosition, CameraForward);\n"
+			"    // Misses and hits behind the near plane get moved out of the clip volume\n"
+			"    if (hit.w < 0.5 || forward <= NearDistance) {\n"
+			"        gl_Position = vec4(2, 2, 2, 1);\n"
+			"        StartDepth = 0;\n"
+			"        return;\n"
+			"    }\n"
+			"    // Rays start on the near plane, so that part of the distance isn't marched\n"
+			"    StartDepth = distance(hit.xyz, CameraPosition) * (1.0 - NearDistance / forward);\n"
+			"    gl_Position = VP * vec4(hit.xyz, 1);\n"
+			"    // Hits past the projection's far plane still count\n"
+			"    gl_Position.z = 0;\n"
+			"}";
+
+		const char* ReprojectFS = "#version 330 core\n"
+			"in float StartDepth;\n"
+			"out vec4 FragColor;\n"
+			"\n"
+			"void main() {\n"
+			"    FragColor = vec4(StartDepth, 0, 0, 1);\n"
+			"}";
+	}
+
+	DepthReprojector::DepthReprojector()
+		: m_target({ GL_R32F }) {
+		m_shader.AddShaderString(ReprojectVS, ShaderType::VERTEX_SHADER, "Reproject VS");
+		m_shader.AddShaderString(ReprojectFS, ShaderType::FRAGMENT_SHADER, "Reproject FS");
+		m_shader.Compile();
+
+		//The points have no attributes, they fetch their hit from gl_VertexID
+		glGenVertexArrays(1, &m_VAO);
+	}
+
+	void DepthReprojector::Reproject(GLuint hitPositions, int lastWidth, int lastHeight, const Camera& camera, int width, int height) {
+		m_target.Resize(width, height);
+		m_target.Bind();
+		glClearColor(1e30f, 0.f, 0.f, 0.f);
+		glClear(GL_COLOR_BUFFER_BIT);
+
+		glm::vec3 forward = glm::normalize(camera.Target - camera.Position);
+		m_shader.Bind();
+		m_shader.SendUniform("HitPositions", 0);
+		m_shader.SendUniform("LastWidth", lastWidth);
+		m_shader.SendUniform("VP", camera.VP);
+		m_shader.SendUniform("CameraPosition", camera.Position);
+		m_shader.SendUniform("CameraForward", forward);
+		m_shader.SendUniform("NearDistance", glm::dot(camera.NearPlanePoint(glm::vec2(0.5f)) - camera.Position, forward));
+
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, hitPositions);
+		//Where several hits land on one pixel the closest has to win, anything further could skip past it
+		glEnable(GL_BLEND);
+		glBlendEquation(GL_MIN);
+		glBindVertexArray(m_VAO);
+		glDrawArrays(GL_POINTS, 0, lastWidth * lastHeight);
+
+		glBindVertexArray(0);
+		glBlendEquation(GL_FUNC_ADD);
+		glDisable(GL_BLEND);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glClearColor(0.5f, 0.5f, 0.5f, 1.f);
+	}
+
+	DepthReprojector::~DepthReprojector() {
+		glDeleteVertexArrays(1, &m_VAO);
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <memory>
+
+#include "../Maths.h"
+#include "Shader.h"
+#include "Camera.h"
+#include "RenderTarget.h"
+
+/*
+	Carries last frame's hits over to the new view: every hit is drawn as a point with the new VP and the closest one per pixel wins.
+	What comes out is the depth along the new ray at which each pixel saw something last frame, or a huge value where nothing landed.
+	The main shader backs off from that depth and checks it's still in free space before starting there.
+*/
+
+namespace marcher {
+	class DepthReprojector {
+	public:
+		DepthReprojector();
+
+		//hitPositions holds a world position per pixel of the last frame with w set to 1 for hits.
+		//The camera must already be updated for the new frame
+		void Reproject(GLuint hitPositions, int lastWidth, int lastHeight, const Camera& camera, int width, int height);
+		void BindTexture(int unit) { m_target.BindTexture(unit); }
+
+		~DepthReprojector();
+
+	private:
+		Shader m_shader;
+		RenderTarget m_target;
+		GLuint m_VAO;
+	};
+}
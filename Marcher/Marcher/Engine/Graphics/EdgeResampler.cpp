@@ -0,0 +1,124 @@
+#include "EdgeResampler.h"
+
+namespace marcher {
+	namespace {
+		const char* EdgeFS = "#version 330 core\n"
+			"out vec4 FragColor;\n"
+			"\n"
+			"uniform sampler2D March, Positions, Surfaces, Color;\n"
+			"uniform vec3 CameraPosition;\n"
+			"// Width of a pixel per unit of distance from the camera\n"
+			"uniform float PixelSpread;\n"
+			"\n"
+			"// Whether two neighbouring pixels see different surfaces, or the same one differently lit\n"
+			"bool Edge(ivec2 a, ivec2 b) {\n"
+			"    vec4 pa = texelFetch(Positions, a, 0), pb = texelFetch(Positions, b, 0);\n"
+			"    if ((pa.w == 0) != (pb.w == 0)) {\n"
+			"        return true;\n"
+			"    }\n"
+			"    if (pa.w != 0) {\n"
+			"        // Neighbours on the same surface stay within a pixel of each other's tangent plane, however steeply it's seen\n"
+			"        vec4 sa = texelFetch(Surfaces, a, 0), sb = texelFetch(Surfaces, b, 0);\n"
+			"        if (abs(dot(sa.xyz, pb.xyz - pa.xyz)) > PixelSpread * distance(pa.xyz, CameraPosition)) {\n"
+			"            return true;\n"
+			"        }\n"
+			"        if (dot(sa.xyz, sb.xyz) < 0.9 || sa.w != sb.w) {\n"
+			"            return true;\n"
+			"        }\n"
+			"    }\n"
+			"    // Shadow edges only show up in the colors\n"
+			"    vec3 luma = vec3(0.299, 0.587, 0.114);\n"
+			"    return abs(dot(texelFetch(Color, a, 0).rgb - texelFetch(Color, b, 0).rgb, luma)) > 0.1;\n"
+			"}\n"
+			"\n"
+			"void main() {\n"
+			"    ivec2 pixel = ivec2(gl_FragCoord.xy);\n"
+			"    ivec2 size = textureSize(Positions, 0);\n"
+			"    vec4 march = texelFetch(March, pixel, 0);\n"
+			"    if (march.x < 0) {\n"
+			"        FragColor = vec4(0);\n"
+			"        return;\n"
+			"    }\n"
+			"    // A miss that came closer to a surface than a pixel's width may have clipped it somewhere in the pixel\n"
+			"    bool edge = texelFetch(Positions, pixel, 0).w == 0 && march.z < PixelSpread;\n"
+			"    ivec2 offsets[4] = ivec2[](ivec2(1, 0), ivec2(-1, 0), ivec2(0, 1), ivec2(0, -1));\n"
+			"    for (int i = 0; i < 4 && !edge; i++) {\n"
+			"        edge = Edge(pixel, clamp(pixel + offsets[i], ivec2(0), size - 1));\n"
+			"    }\n"
+			"    FragColor = vec4(edge ? 1.0 : 0.0);\n"
+			"}";
+	}
+
+	EdgeResampler::EdgeResampler()
+		: m_shader(std::make_shared<Shader>()), m_mask({ GL_R8 }), m_queries(GL_SAMPLES_PASSED) {
+		m_shader->AddShaderString(FullscreenVS, ShaderType::VERTEX_SHADER, "Edge VS");
+		m_shader->AddShaderString(EdgeFS, ShaderType::FRAGMENT_SHADER, "Edge FS");
+		m_shader->Compile();
+		glGenVertexArrays(1, &m_VAO);
+	}
+
+	void EdgeResampler::FindEdges(GBuffer& gbuffer, RenderTarget& frame, const Camera& camera) {
+		m_mask.Resize(frame.Width(), frame.Height());
+		m_mask.Bind();
+
+		//Rays start on the near plane, so a pixel's width there over the plane's distance is how fast its footprint grows
+		float pixelWidth = glm::distance(camera.TopLeft, camera.TopRight) / frame.Width();
+		float nearDistance = glm::distance(camera.Position, camera.NearPlanePoint(glm::vec2(0.5f)));
+
+		m_shader->Bind();
+		m_shader->SendUniform("CameraPosition", camera.Position);
+		m_shader->SendUniform("PixelSpread", pixelWidth / nearDistance);
+
+		const char* names[] = { "March", "Positions", "Surfaces" };
+		for (int i = 0; i < 3; i++) {
+			gbuffer.BindTexture(i, i);
+			m_shader->SendUniform(names[i], i);
+		}
+		frame.BindTexture(3, 0);
+		m_shader->SendUniform("Color", 3);
+
+		glBindVertexArray(m_VAO);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		glBindVertexArray(0);
+	}
+
+	void EdgeResampler::Resample(std::shared_ptr<Shader> shader, GLuint VAO, RenderTarget& frame, int samples) {
+		frame.Bind();
+		m_mask.BindTexture(9);
+		shader->SendUniform("EdgeMask", 9);
+		shader->SendUniform("EdgeSamples", samples);
+		shader->SendUniform("EdgeResample", 1);
+
+		//The shader outputs the average of its new rays with an alpha that weighs it against the one sample already there.
+		//Hit positions stay those of the pixel centres
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glColorMaski(1, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+		//Unmarked pixels are discarded, so the samples that pass are the pixels that got resampled
+		bool counted = m_queries.Begin();
+		glBindVertexArray(VAO);
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+		if (counted)
+			m_pixels[m_queries.End()] = frame.Width() * frame.Height();
+
+		glColorMaski(1, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glDisable(GL_BLEND);
+		shader->SendUniform("EdgeResample", 0);
+	}
+
+	bool EdgeResampler::Poll(float& fraction) {
+		bool found = false;
+		GLuint64 passed;
+		int slot;
+		while (m_queries.Poll(passed, slot)) {
+			fraction = (float)passed / glm::max(m_pixels[slot], 1);
+			found = true;
+		}
+		return found;
+	}
+
+	EdgeResampler::~EdgeResampler() {
+		glDeleteVertexArrays(1, &m_VAO);
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <memory>
+
+#include "../Maths.h"
+#include "Shader.h"
+#include "RenderTarget.h"
+#include "Camera.h"
+#include "GBuffer.h"
+#include "QueryRing.h"
+
+/*
+	Antialiasing that only spends rays where a pixel's single sample can be wrong: silhouettes, creases, shadow edges,
+	and misses whose ray grazed past a surface within a pixel's width of it.
+	The G-buffer and the lit frame mark those pixels in a mask, then the main shader marches a few more jittered rays
+	for each marked pixel and blends them into the frame. Everything else keeps its one sample.
+*/
+
+namespace marcher {
+	class EdgeResampler {
+	public:
+		EdgeResampler();
+
+		//Marks the pixels of frame worth resampling from gbuffer's surfaces and frame's colors. Leaves the mask shader bound
+		void FindEdges(GBuffer& gbuffer, RenderTarget& frame, const Camera& camera);
+		//Blends samples more rays into each marked pixel of frame. shader must be the bound main shader with every render uniform sent
+		void Resample(std::shared_ptr<Shader> shader, GLuint VAO, RenderTarget& frame, int samples);
+		//Gets the fraction of pixels the newest finished Resample() covered, returns false if none finished since the last call.
+		//The count comes from an occlusion query, so like the GPU timer it's a few frames late and never waited on
+		bool Poll(float& fraction);
+
+		~EdgeResampler();
+
+	private:
+		std::shared_ptr<Shader> m_shader;
+		RenderTarget m_mask;
+		GLuint m_VAO;
+
+		QueryRing m_queries;
+		//Pixels in the frame each query's pass ran over
+		int m_pixels[QueryRing::Size];
+	};
+}
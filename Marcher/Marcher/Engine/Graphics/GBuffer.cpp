@@ -0,0 +1,49 @@
+#include "GBuffer.h"
+
+namespace marcher {
+	bool operator==(const GeometryState& left, const GeometryState& right) {
+		return left.VP == right.VP && left.CameraPosition == right.CameraPosition && left.Jitter == right.Jitter && left.Size == right.Size
+			&& left.Epsilon == right.Epsilon && left.MaxDistance == right.MaxDistance && left.Relaxation == right.Relaxation
+			&& left.MaxSteps == right.MaxSteps && left.VariableRate == right.VariableRate;
+	}
+
+	bool operator!=(const GeometryState& left, const GeometryState& right) {
+		return !(left == right);
+	}
+
+	GBuffer::GBuffer()
+		//Normals and material IDs are fine at half precision, positions and depths need the full one
+		: m_target({ GL_RGBA32F, GL_RGBA32F, GL_RGBA16F }), m_state(), m_coverage(0) {
+	}
+
+	bool GBuffer::Covers(const GeometryState& state) const {
+		return m_coverage >= 2 && m_state == state;
+	}
+
+	void GBuffer::Bind(const GeometryState& state, bool checkerboard) {
+		if (m_state != state)
+			m_coverage = 0;
+		m_state = state;
+		m_coverage = checkerboard ? glm::min(m_coverage + 1, 2) : 2;
+
+		m_target.Resize(state.Size.x, state.Size.y);
+		m_target.Bind();
+	}
+
+	void GBuffer::BindImages(const GeometryState& state, int firstUnit) {
+		m_state = state;
+		m_coverage = 2;
+
+		m_target.Resize(state.Size.x, state.Size.y);
+		for (int i = 0; i < 3; i++)
+			m_target.BindImage(firstUnit + i, i, GL_READ_WRITE);
+	}
+
+	void GBuffer::BindTextures(std::shared_ptr<Shader> shader, int firstUnit) {
+		const char* names[] = { "GBufferMarch", "GBufferPosition", "GBufferSurface" };
+		for (int i = 0; i < 3; i++) {
+			m_target.BindTexture(firstUnit + i, i);
+			shader->SendUniform(names[i], firstUnit + i);
+		}
+	}
+}
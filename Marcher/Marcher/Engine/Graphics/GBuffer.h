@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <memory>
+
+#include "../Maths.h"
+#include "Shader.h"
+#include "RenderTarget.h"
+
+/*
+	Holds what the main shader's geometry pass found along each pixel's ray: the march's depth, steps, how closely it grazed the scene and SDF calls,
+	the hit position and the normal with the material ID. The lighting pass shades from it without marching any primary rays.
+	As long as nothing the surfaces depend on changes, changing the lighting only takes the lighting pass.
+*/
+
+namespace marcher {
+	//Everything the marched surfaces depend on, other than the scene itself
+	struct GeometryState {
+		glm::mat4 VP;
+		glm::vec3 CameraPosition;
+		//Sub-pixel offset of the rays, relative to the frame size
+		glm::vec2 Jitter;
+		glm::ivec2 Size;
+		float Epsilon, MaxDistance, Relaxation;
+		int MaxSteps, VariableRate;
+	};
+
+	bool operator==(const GeometryState& left, const GeometryState& right);
+	bool operator!=(const GeometryState& left, const GeometryState& right);
+
+	class GBuffer {
+	public:
+		GBuffer();
+
+		//True when every pixel has been marched with state since the last Invalidate(), so the geometry pass can be skipped
+		bool Covers(const GeometryState& state) const;
+		//Resizes and binds the G-buffer for a geometry pass with state. Checkerboard passes only march half the pixels,
+		//so it takes two of them in a row to cover the frame
+		void Bind(const GeometryState& state, bool checkerboard);
+		//Resizes the G-buffer and binds its three textures as images from firstUnit on, for a compute pass that marches every pixel with state
+		void BindImages(const GeometryState& state, int firstUnit);
+		//Forgets what was marched, for when the scene itself changed
+		void Invalidate() { m_coverage = 0; }
+		//Binds the march info, hit positions and normals to firstUnit and the two units after it, and points the shader's samplers at them
+		void BindTextures(std::shared_ptr<Shader> shader, int firstUnit);
+		//Binds one of them on its own, index 0 is the march info, 1 the hit positions and 2 the normals
+		void BindTexture(int unit, int index) { m_target.BindTexture(unit, index); }
+
+	private:
+		RenderTarget m_target;
+		GeometryState m_state;
+		//Halves of the frame marched with m_state, 2 once all of it is
+		int m_coverage;
+	};
+}
@@ -0,0 +1,30 @@
+#include "GpuTimer.h"
+
+namespace marcher {
+	GpuTimer::GpuTimer()
+		: m_queries(GL_TIME_ELAPSED), m_running(false) {
+
+	}
+
+	void GpuTimer::Begin() {
+		m_running = m_queries.Begin();
+	}
+
+	void GpuTimer::End() {
+		if (!m_running)
+			return;
+		m_queries.End();
+		m_running = false;
+	}
+
+	bool GpuTimer::Poll(float& milliseconds) {
+		bool found = false;
+		GLuint64 nanoseconds;
+		int slot;
+		while (m_queries.Poll(nanoseconds, slot)) {
+			milliseconds = (float)(nanoseconds / 1000000.0);
+			found = true;
+		}
+		return found;
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "QueryRing.h"
+
+/*
+	Measures how long the GPU spends between Begin() and End() with timer queries.
+	Results arrive a few frames late, Poll() picks them up without ever waiting on the GPU.
+*/
+
+namespace marcher {
+	class GpuTimer {
+	public:
+		GpuTimer();
+
+		//Does nothing when every query is still waiting on the GPU, that frame just isn't measured
+		void Begin();
+		void End();
+		//Gets the newest finished measurement, returns false if none finished since the last call
+		bool Poll(float& milliseconds);
+
+	private:
+		QueryRing m_queries;
+		bool m_running;
+	};
+}
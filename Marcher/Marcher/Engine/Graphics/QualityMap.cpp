@@ -0,0 +1,90 @@
+#include "QualityMap.h"
+
+namespace marcher {
+	namespace {
+		const char* QualityFS = "#version 330 core\n"
+			"out vec4 FragColor;\n"
+			"\n"
+			"uniform int Mode;\n"
+			"uniform int TileSize;\n"
+			"uniform int MaxLevel;\n"
+			"uniform vec2 ScreenSize;\n"
+			"uniform sampler2D LastColor, LastPositions;\n"
+			"uniform bool LastValid;\n"
+			"uniform vec3 CameraPosition;\n"
+			"\n"
+			"// How much of an edge there is between two neighbouring pixels of the last frame, 1 for a depth discontinuity\n"
+			"float Edge(ivec2 a, ivec2 b) {\n"
+			"    vec4 pa = texelFetch(LastPositions, a, 0), pb = texelFetch(LastPositions, b, 0);\n"
+			"    if ((pa.w == 0) != (pb.w == 0)) {\n"
+			"        return 1.0;\n"
+			"    }\n"
+			"    if (pa.w != 0 && distance(pa.xyz, pb.xyz) > 0.05 * distance(pa.xyz, CameraPosition)) {\n"
+			"        return 1.0;\n"
+			"    }\n"
+			"    vec3 luma = vec3(0.299, 0.587, 0.114);\n"
+			"    return abs(dot(texelFetch(LastColor, a, 0).rgb - texelFetch(LastColor, b, 0).rgb, luma)) * 10.0;\n"
+			"}\n"
+			"\n"
+			"void main() {\n"
+			"    ivec2 tile = ivec2(gl_FragCoord.xy);\n"
+			"    int level = MaxLevel;\n"
+			"    if (Mode == 1) {\n"
+			"        // Rings around the middle of the screen, by distance relative to the corners\n"
+			"        vec2 center = (vec2(tile) + 0.5) * TileSize / ScreenSize * 2.0 - 1.0;\n"
+			"        float radius = length(center) / sqrt(2.0);\n"
+			"        level = radius < 0.5 ? MaxLevel : MaxLevel - int((radius - 0.5) / 0.15) - 1;\n"
+			"    }\n"
+			"    else if (Mode == 2 && LastValid) {\n"
+			"        // Every other pixel of the tile is enough to find its edges. Flat tiles never go below 1 so they keep their shadows,\n"
+			"        // otherwise the shadow's own edge would flip them back and forth\n"
+			"        ivec2 size = textureSize(LastColor, 0);\n"
+			"        vec2 scale = vec2(size) / ScreenSize;\n"
+			"        float edge = 0.0;\n"
+			"        for (int y = 0; y < TileSize; y += 2) {\n"
+			"            for (int x = 0; x < TileSize; x += 2) {\n"
+			"                ivec2 texel = clamp(ivec2(vec2(tile * TileSize + ivec2(x, y)) * scale), ivec2(0), size - 2);\n"
+			"                edge = max(edge, max(Edge(texel, texel + ivec2(1, 0)), Edge(texel, texel + ivec2(0, 1))));\n"
+			"            }\n"
+			"        }\n"
+			"        level = edge > 0.5 ? MaxLevel : edge > 0.2 ? MaxLevel - 1 : 1;\n"
+			"    }\n"
+			"    FragColor = vec4(float(clamp(level, 0, MaxLevel)) / MaxLevel);\n"
+			"}";
+	}
+
+	QualityMap::QualityMap()
+		: m_shader(std::make_shared<Shader>()), m_target({ GL_R8 }) {
+		m_shader->AddShaderString(FullscreenVS, ShaderType::VERTEX_SHADER, "Quality VS");
+		m_shader->AddShaderString(QualityFS, ShaderType::FRAGMENT_SHADER, "Quality FS");
+		m_shader->Compile();
+		glGenVertexArrays(1, &m_VAO);
+	}
+
+	void QualityMap::Update(QualityMode mode, int width, int height, RenderTarget& last, bool lastValid, const glm::vec3& cameraPosition) {
+		//One texel per tile, rounded up so the edges are covered too
+		m_target.Resize((width + TileSize - 1) / TileSize, (height + TileSize - 1) / TileSize);
+		m_target.Bind();
+
+		m_shader->Bind();
+		m_shader->SendUniform("Mode", (int)mode);
+		m_shader->SendUniform("TileSize", TileSize);
+		m_shader->SendUniform("MaxLevel", MaxLevel);
+		m_shader->SendUniform("ScreenSize", glm::vec2(width, height));
+		m_shader->SendUniform("LastValid", (int)lastValid);
+		m_shader->SendUniform("CameraPosition", cameraPosition);
+
+		last.BindTexture(0, 0);
+		last.BindTexture(1, 1);
+		m_shader->SendUniform("LastColor", 0);
+		m_shader->SendUniform("LastPositions", 1);
+
+		glBindVertexArray(m_VAO);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		glBindVertexArray(0);
+	}
+
+	QualityMap::~QualityMap() {
+		glDeleteVertexArrays(1, &m_VAO);
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <memory>
+
+#include "../Maths.h"
+#include "Shader.h"
+#include "RenderTarget.h"
+
+/*
+	Picks how carefully each TileSize x TileSize tile of the frame gets marched, as a level from 0 to MaxLevel.
+	Foveated maps drop the level towards the edges of the screen. Edge maps look at last frame's color and hit positions
+	and keep full quality only where those had edges, flat tiles get a coarser march and no AO.
+	The main shader turns the level into its epsilon, step cap and whether shadows and AO run.
+*/
+
+namespace marcher {
+	enum QualityMode {
+		QUALITY_OFF,
+		QUALITY_FOVEATED,
+		QUALITY_EDGES
+	};
+
+	class QualityMap {
+	public:
+		QualityMap();
+
+		//last holds the color and hit positions of the last frame, without them an edge map is full quality everywhere.
+		//Leaves the map shader bound
+		void Update(QualityMode mode, int width, int height, RenderTarget& last, bool lastValid, const glm::vec3& cameraPosition);
+		void BindTexture(int unit) { m_target.BindTexture(unit); }
+
+		~QualityMap();
+
+		static const int TileSize = 16;
+		static const int MaxLevel = 3;
+
+	private:
+		std::shared_ptr<Shader> m_shader;
+		RenderTarget m_target;
+		GLuint m_VAO;
+	};
+}
@@ -0,0 +1,42 @@
+#include "QueryRing.h"
+
+namespace marcher {
+	QueryRing::QueryRing(GLenum target)
+		: m_target(target), m_next(0), m_pending(0) {
+		glGenQueries(Size, m_queries);
+	}
+
+	bool QueryRing::Begin() {
+		if (m_pending == Size)
+			return false;
+		glBeginQuery(m_target, m_queries[m_next]);
+		return true;
+	}
+
+	int QueryRing::End() {
+		glEndQuery(m_target);
+		int slot = m_next;
+		m_next = (m_next + 1) % Size;
+		m_pending++;
+		return slot;
+	}
+
+	bool QueryRing::Poll(GLuint64& result, int& slot) {
+		if (m_pending == 0)
+			return false;
+		//Queries finish in order, so the oldest one decides whether there's anything to read
+		slot = (m_next - m_pending + Size) % Size;
+		GLint available = 0;
+		glGetQueryObjectiv(m_queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			return false;
+
+		glGetQueryObjectui64v(m_queries[slot], GL_QUERY_RESULT, &result);
+		m_pending--;
+		return true;
+	}
+
+	QueryRing::~QueryRing() {
+		glDeleteQueries(Size, m_queries);
+	}
+}
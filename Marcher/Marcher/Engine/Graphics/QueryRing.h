@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glad/glad.h>
+
+/*
+	A handful of GL queries used in turn, so each result can be read a few frames after its query ended without ever waiting on the GPU.
+*/
+
+namespace marcher {
+	class QueryRing {
+	public:
+		//target is what the queries measure, GL_TIME_ELAPSED or GL_SAMPLES_PASSED
+		QueryRing(GLenum target);
+
+		//Begins the next query, or returns false without one when every query is still waiting on the GPU
+		bool Begin();
+		//Ends the query Begin() started and returns its slot, for keeping whatever its result should be read with
+		int End();
+		//Takes the oldest query's result and slot if it has finished, returns false if it hasn't or nothing is waiting
+		bool Poll(GLuint64& result, int& slot);
+
+		~QueryRing();
+
+		static const int Size = 4;
+
+	private:
+		GLenum m_target;
+		GLuint m_queries[Size];
+		int m_next, m_pending;
+	};
+}
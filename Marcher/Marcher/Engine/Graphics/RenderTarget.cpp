@@ -0,0 +1,75 @@
+#include "RenderTarget.h"
+
+#include <cstdio>
+
+namespace marcher {
+	RenderTarget::RenderTarget(std::vector<GLenum> formats, GLenum filter)
+		: m_formats(formats), m_textures(formats.size()), m_framebuffer(0), m_width(0), m_height(0) {
+		glGenTextures((GLsizei)m_textures.size(), &m_textures[0]);
+		for (size_t i = 0; i < m_textures.size(); i++) {
+			glBindTexture(GL_TEXTURE_2D, m_textures[i]);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glGenFramebuffers(1, &m_framebuffer);
+	}
+
+	void RenderTarget::Resize(int width, int height) {
+		width = width > 1 ? width : 1;
+		height = height > 1 ? height : 1;
+		if (width == m_width && height == m_height)
+			return;
+		m_width = width;
+		m_height = height;
+
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+		std::vector<GLenum> attachments;
+		for (size_t i = 0; i < m_textures.size(); i++) {
+			glBindTexture(GL_TEXTURE_2D, m_textures[i]);
+			glTexImage2D(GL_TEXTURE_2D, 0, m_formats[i], width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + (GLenum)i, GL_TEXTURE_2D, m_textures[i], 0);
+			attachments.push_back(GL_COLOR_ATTACHMENT0 + (GLenum)i);
+		}
+		glDrawBuffers((GLsizei)attachments.size(), &attachments[0]);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			printf("Render target framebuffer is incomplete\n");
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	void RenderTarget::Bind() {
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+		glViewport(0, 0, m_width, m_height);
+	}
+
+	void RenderTarget::Unbind(int width, int height) {
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, width, height);
+	}
+
+	void RenderTarget::BindTexture(int unit, int index) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_2D, m_textures[index]);
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	void RenderTarget::BindImage(int unit, int index, GLenum access) {
+		glBindImageTexture(unit, m_textures[index], 0, GL_FALSE, 0, access, m_formats[index]);
+	}
+
+	void RenderTarget::BlitToWindow(int width, int height, GLenum filter) {
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, filter);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	RenderTarget::~RenderTarget() {
+		glDeleteFramebuffers(1, &m_framebuffer);
+		glDeleteTextures((GLsizei)m_textures.size(), &m_textures[0]);
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+
+/*
+	A framebuffer with one or more color textures of the same size, for passes that render somewhere other than the window.
+*/
+
+namespace marcher {
+	class RenderTarget {
+	public:
+		//One color attachment per internal format, in order
+		RenderTarget(std::vector<GLenum> formats = { GL_RGBA8 }, GLenum filter = GL_NEAREST);
+
+		//Reallocates the textures if the size changed, their contents are undefined afterwards
+		void Resize(int width, int height);
+		//Binds the framebuffer and sets the viewport to cover it
+		void Bind();
+		//Binds the window's framebuffer again with a viewport of the given size
+		static void Unbind(int width, int height);
+		void BindTexture(int unit, int index = 0);
+		//Binds a texture as an image for shaders to load from or store to, access is GL_READ_ONLY, GL_WRITE_ONLY or GL_READ_WRITE
+		void BindImage(int unit, int index, GLenum access);
+		//Copies the first texture onto the window's framebuffer, stretched to width*height
+		void BlitToWindow(int width, int height, GLenum filter = GL_NEAREST);
+
+		GLuint Texture(int index = 0) const { return m_textures[index]; }
+		int Width() const { return m_width; }
+		int Height() const { return m_height; }
+
+		~RenderTarget();
+
+	private:
+		std::vector<GLenum> m_formats;
+		std::vector<GLuint> m_textures;
+		GLuint m_framebuffer;
+		int m_width, m_height;
+	};
+}
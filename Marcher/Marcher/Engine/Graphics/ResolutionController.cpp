@@ -0,0 +1,22 @@
+#include "ResolutionController.h"
+
+#include "../Maths.h"
+
+namespace marcher {
+	ResolutionController::ResolutionController(float minScale, float maxScale)
+		: m_scale(maxScale), m_minScale(minScale), m_maxScale(maxScale) {
+
+	}
+
+	float ResolutionController::Update(float milliseconds, float budget) {
+		float ratio = budget / glm::max(milliseconds, 0.01f);
+		//Close enough, chasing small differences only makes the image pump
+		if (ratio > 0.95f && ratio < 1.05f)
+			return m_scale;
+
+		float target = glm::clamp(m_scale * glm::sqrt(ratio), m_minScale, m_maxScale);
+		//Measurements lag a few frames behind, so the scale drops fast to cut spikes short and climbs slowly to not overshoot
+		m_scale = glm::mix(m_scale, target, target < m_scale ? 0.5f : 0.1f);
+		return m_scale;
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+/*
+	Picks the render resolution scale that keeps the GPU time of a frame within a budget.
+	The time is taken to grow with the pixel count, so the scale moves with the square root of how far off the budget a frame was.
+*/
+
+namespace marcher {
+	class ResolutionController {
+	public:
+		ResolutionController(float minScale = 0.25f, float maxScale = 1.f);
+
+		//Takes the GPU time of a recent frame and returns the scale to render the next one at
+		float Update(float milliseconds, float budget);
+		float Scale() const { return m_scale; }
+
+	private:
+		float m_scale, m_minScale, m_maxScale;
+	};
+}
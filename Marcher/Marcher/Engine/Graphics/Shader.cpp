@@ -3,6 +3,12 @@
 #include <glad/glad.h>
 
 namespace marcher {
+	const char* FullscreenVS = "#version 330 core\n"
+		"void main() {\n"
+		"    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+		"    gl_Position = vec4(corner * 2.0 - 1.0, 0, 1);\n"
+		"}";
+
 	GLenum ShaderTypeToGL(ShaderType type) {
 		switch (type) {
 		case ShaderType::FRAGMENT_SHADER:
@@ -11,6 +17,8 @@ namespace marcher {
 			return GL_VERTEX_SHADER;
 		case ShaderType::GEOMETRY_SHADER:
 			return GL_GEOMETRY_SHADER;
+		case ShaderType::COMPUTE_SHADER:
+			return GL_COMPUTE_SHADER;
 		default:
 			throw std::exception("Unknown shader type");
 		}
@@ -19,11 +27,13 @@ namespace marcher {
 	}
 
 
-	Shader::Shader() {
+	Shader::Shader()
+		: m_uniformHash(HashSeed), m_linked(false) {
 
 	}
 
-	Shader::Shader(std::string vsPath, std::string fsPath) {
+	Shader::Shader(std::string vsPath, std::string fsPath)
+		: m_uniformHash(HashSeed), m_linked(false) {
 		AddShader(vsPath, VERTEX_SHADER);
 		AddShader(fsPath, FRAGMENT_SHADER);
 		Compile();
@@ -74,6 +84,16 @@ namespace marcher {
 			glAttachShader(ProgramID, m_shaders[i]);
 		}
 		glLinkProgram(ProgramID);
+
+		GLint success;
+		GLchar infoLog[1024];
+		glGetProgramiv(ProgramID, GL_LINK_STATUS, &success);
+		m_linked = success != 0;
+		if (!m_linked) {
+			glGetProgramInfoLog(ProgramID, 1024, nullptr, infoLog);
+
+			printf("Shader Link Error\n%s", infoLog);
+		}
 		for (size_t i = 0; i < m_shaders.size(); i++) {
 			glDeleteShader(m_shaders[i]);
 		}
@@ -84,6 +104,14 @@ namespace marcher {
 		glUseProgram(ProgramID);
 	}
 
+	void Shader::HashUniform(const std::string& name, const void* data, size_t size) {
+		//Uniforms the compiled program doesn't use can't change what it draws
+		if (m_locations[name] == (unsigned int)-1)
+			return;
+		m_uniformHash = HashBytes(name.data(), name.size(), m_uniformHash);
+		m_uniformHash = HashBytes(data, size, m_uniformHash);
+	}
+
 	template<class T>
 	void Shader::SendUniform(std::string name, T variable) {
 		static_assert(true, "Unsupported shader uniform type!");
@@ -93,78 +121,91 @@ namespace marcher {
 		if (m_locations.find(name) == m_locations.end())
 			m_locations[name] = glGetUniformLocation(ProgramID, name.c_str());
 		glUniform1f(m_locations[name], variable);
+		HashUniform(name, &variable, sizeof(variable));
 	}
 
 	void Shader::SendUniform(std::string name, double variable) {
 		if (m_locations.find(name) == m_locations.end())
 			m_locations[name] = glGetUniformLocation(ProgramID, name.c_str());
 		glUniform1d(m_locations[name], variable);
+		HashUniform(name, &variable, sizeof(variable));
 	}
 
 	void Shader::SendUniform(std::string name, int variable) {
 		if (m_locations.find(name) == m_locations.end())
 			m_locations[name] = glGetUniformLocation(ProgramID, name.c_str());
 		glUniform1i(m_locations[name], variable);
+		HashUniform(name, &variable, sizeof(variable));
 	}
 
 	void Shader::SendUniform(std::string name, glm::vec2 variable) {
 		if (m_locations.find(name) == m_locations.end())
 			m_locations[name] = glGetUniformLocation(ProgramID, name.c_str());
 		glUniform2f(m_locations[name], variable.x, variable.y);
+		HashUniform(name, &variable, sizeof(variable));
 	}
 
 	void Shader::SendUniform(std::string name, glm::ivec2 variable) {
 		if (m_locations.find(name) == m_locations.end())
 			m_locations[name] = glGetUniformLocation(ProgramID, name.c_str());
 		glUniform2i(m_locations[name], variable.x, variable.y);
+		HashUniform(name, &variable, sizeof(variable));
 	}
 
 	void Shader::SendUniform(std::string name, glm::vec3 variable) {
 		if (m_locations.find(name) == m_locations.end())
 			m_locations[name] = glGetUniformLocation(ProgramID, name.c_str());
 		glUniform3f(m_locations[name], variable.x, variable.y, variable.z);
+		HashUniform(name, &variable, sizeof(variable));
 	}
 
 	void Shader::SendUniform(std::string name, glm::ivec3 variable) {
 		if (m_locations.find(name) == m_locations.end())
 			m_locations[name] = glGetUniformLocation(ProgramID, name.c_str());
 		glUniform3i(m_locations[name], variable.x, variable.y, variable.z);
+		HashUniform(name, &variable, sizeof(variable));
 	}
 
 	void Shader::SendUniform(std::string name, glm::vec4 variable) {
 		if (m_locations.find(name) == m_locations.end())
 			m_locations[name] = glGetUniformLocation(ProgramID, name.c_str());
 		glUniform4f(m_locations[name], variable.x, variable.y, variable.z, variable.w);
+		HashUniform(name, &variable, sizeof(variable));
 	}
 
 	void Shader::SendUniform(std::string name, glm::ivec4 variable) {
 		if (m_locations.find(name) == m_locations.end())
 			m_locations[name] = glGetUniformLocation(ProgramID, name.c_str());
 		glUniform4i(m_locations[name], variable.x, variable.y, variable.z, variable.w);
+		HashUniform(name, &variable, sizeof(variable));
 	}
 
 	void Shader::SendUniform(std::string name, glm::mat2 variable) {
 		if (m_locations.find(name) == m_locations.end())
 			m_locations[name] = glGetUniformLocation(ProgramID, name.c_str());
 		glUniformMatrix2fv(m_locations[name], 1, GL_FALSE, &variable[0][0]);
+		HashUniform(name, &variable, sizeof(variable));
 	}
 
 	void Shader::SendUniform(std::string name, glm::mat3 variable) {
 		if (m_locations.find(name) == m_locations.end())
 			m_locations[name] = glGetUniformLocation(ProgramID, name.c_str());
 		glUniformMatrix3fv(m_locations[name], 1, GL_FALSE, &variable[0][0]);
+		HashUniform(name, &variable, sizeof(variable));
 	}
 
 	void Shader::SendUniform(std::string name, glm::mat4 variable) {
 		if (m_locations.find(name) == m_locations.end())
 			m_locations[name] = glGetUniformLocation(ProgramID, name.c_str());
 		glUniformMatrix4fv(m_locations[name], 1, GL_FALSE, &variable[0][0]);
+		HashUniform(name, &variable, sizeof(variable));
 	}
 
 	void Shader::SendUniform(std::string name, Color variable) {
 		if (m_locations.find(name) == m_locations.end())
 			m_locations[name] = glGetUniformLocation(ProgramID, name.c_str());
 		glUniform4f(m_locations[name], variable.r, variable.g, variable.b, variable.a);
+		HashUniform(name, &variable, sizeof(variable));
 	}
 
 	Shader::~Shader() {
@@ -7,6 +7,7 @@
 #include <map>
 
 #include "../Maths.h"
+#include "../Hash.h"
 #include "Color.h"
 
 /*
@@ -14,13 +15,17 @@
 */
 
 namespace marcher {
-	//The shader types supported by Opengl 3.3
+	//The shader types supported by Opengl 3.3, plus compute shaders which need 4.3
 	enum ShaderType {
 		VERTEX_SHADER,
 		FRAGMENT_SHADER,
-		GEOMETRY_SHADER
+		GEOMETRY_SHADER,
+		COMPUTE_SHADER
 	};
 
+	//Vertex shader for passes that draw a single triangle covering their target, built from gl_VertexID so no vertex buffer is needed
+	extern const char* FullscreenVS;
+
 	class Shader {
 	public:
 		Shader();
@@ -31,6 +36,8 @@ namespace marcher {
 		void AddShaderString(std::string shdr, ShaderType type, std::string path = "Shader");
 		void Compile();
 		void Bind();
+		//False if the last Compile() failed to link, the errors have been printed already
+		bool Linked() const { return m_linked; }
 
 		//Sending uniform variables to the shader 
 		template<class T> void SendUniform(std::string name, T variable);
@@ -48,6 +55,10 @@ namespace marcher {
 		void SendUniform(std::string name, glm::mat4 variable);
 		void SendUniform(std::string name, Color variable);
 
+		//Hash of every uniform the program uses that was sent since the last ResetUniformHash(), names included
+		unsigned long long UniformHash() const { return m_uniformHash; }
+		void ResetUniformHash() { m_uniformHash = HashSeed; }
+
 		~Shader();
 
 		unsigned int ProgramID;
@@ -56,5 +67,9 @@ namespace marcher {
 		//m_locations is a map of all the uniform locations retrieved from the shader. It is stored instead of just retrieving them again for performance sakes
 		std::map<std::string, unsigned int> m_locations;
 		std::vector<unsigned int> m_shaders;
+		unsigned long long m_uniformHash;
+		bool m_linked;
+
+		void HashUniform(const std::string& name, const void* data, size_t size);
 	};
 }
\ No newline at end of file
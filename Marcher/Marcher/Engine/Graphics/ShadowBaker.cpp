@@ -0,0 +1,68 @@
+#include "ShadowBaker.h"
+
+namespace marcher {
+	ShadowBaker::ShadowBaker(int resolution)
+		: m_target({ GL_R32F }), m_resolution(resolution), m_row(0), m_transform(1.f), m_texelSize(0.f),
+		m_lightDir(0.f), m_sceneMin(0.f), m_sceneMax(0.f), m_extent(0.f) {
+		m_target.Resize(resolution, resolution);
+		Invalidate();
+	}
+
+	void ShadowBaker::Update(const glm::vec3& lightDir, const glm::vec3& sceneMin, const glm::vec3& sceneMax, float extent) {
+		if (m_row >= 0 && lightDir == m_lightDir && sceneMin == m_sceneMin && sceneMax == m_sceneMax && extent == m_extent)
+			return;
+		m_lightDir = lightDir;
+		m_sceneMin = sceneMin;
+		m_sceneMax = sceneMax;
+		m_extent = extent;
+		m_row = 0;
+
+		glm::vec3 forward = glm::normalize(lightDir);
+		glm::vec3 up = glm::abs(forward.y) < 0.99f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0);
+		glm::vec3 right = glm::normalize(glm::cross(up, forward));
+		up = glm::cross(forward, right);
+
+		//The map covers the region's corners as seen from the light
+		glm::vec3 regionMin = glm::max(sceneMin, glm::vec3(-extent));
+		glm::vec3 regionMax = glm::max(glm::min(sceneMax, glm::vec3(extent)), regionMin);
+		glm::vec2 min = glm::vec2(1e30f), max = glm::vec2(-1e30f);
+		for (int i = 0; i < 8; i++) {
+			glm::vec3 corner = glm::vec3(i & 1 ? regionMax.x : regionMin.x, i & 2 ? regionMax.y : regionMin.y, i & 4 ? regionMax.z : regionMin.z);
+			glm::vec2 projected = glm::vec2(glm::dot(corner, right), glm::dot(corner, up));
+			min = glm::min(min, projected);
+			max = glm::max(max, projected);
+		}
+		glm::vec2 size = glm::max(max - min, glm::vec2(1e-3f));
+
+		m_transform = glm::mat4(
+			right.x / size.x, up.x / size.y, forward.x, 0.f,
+			right.y / size.x, up.y / size.y, forward.y, 0.f,
+			right.z / size.x, up.z / size.y, forward.z, 0.f,
+			-min.x / size.x, -min.y / size.y, 0.f, 1.f);
+		m_texelSize = glm::max(size.x, size.y) / m_resolution;
+	}
+
+	void ShadowBaker::Invalidate() {
+		m_row = -1;
+	}
+
+	bool ShadowBaker::Bake(std::shared_ptr<Shader> shader, GLuint VAO) {
+		if (m_row < 0 || Ready())
+			return Ready();
+
+		m_target.Bind();
+		shader->SendUniform("ScreenSize", glm::vec2(m_resolution));
+		shader->SendUniform("ShadowMapInverse", glm::inverse(m_transform));
+		shader->SendUniform("ShadowBake", 1);
+
+		glEnable(GL_SCISSOR_TEST);
+		glScissor(0, m_row, m_resolution, RowsPerFrame);
+		glBindVertexArray(VAO);
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+		glDisable(GL_SCISSOR_TEST);
+
+		shader->SendUniform("ShadowBake", 0);
+		m_row += RowsPerFrame;
+		return Ready();
+	}
+}
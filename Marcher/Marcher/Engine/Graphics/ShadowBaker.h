@@ -0,0 +1,48 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <memory>
+
+#include "../Maths.h"
+#include "Shader.h"
+#include "RenderTarget.h"
+
+/*
+	Bakes a shadow map for the directional light: a grid of rays is marched along the light through the scene bounds,
+	and each texel keeps how far along the light its ray got before hitting something.
+	Baking is spread over several frames, until it's done the main shader keeps marching its own shadow rays.
+*/
+
+namespace marcher {
+	class ShadowBaker {
+	public:
+		ShadowBaker(int resolution = 1024);
+
+		//Starts a new bake if the light or the region changed. Only the part of sceneMin to sceneMax within extent of the origin gets a map,
+		//but the rays are marched through all of the scene bounds so occluders outside it still count
+		void Update(const glm::vec3& lightDir, const glm::vec3& sceneMin, const glm::vec3& sceneMax, float extent);
+		//Forgets the map, for when the scene itself changed
+		void Invalidate();
+		//Bakes the next RowsPerFrame rows. shader must be the bound main shader with every render uniform sent,
+		//its viewport and ScreenSize are changed. Returns true once the map is complete
+		bool Bake(std::shared_ptr<Shader> shader, GLuint VAO);
+
+		bool Ready() const { return m_row >= m_resolution; }
+		float Progress() const { return glm::min((float)m_row / m_resolution, 1.f); }
+		void BindTexture(int unit) { m_target.BindTexture(unit); }
+		//Takes a world position to its texel in x and y (from 0 to 1) and its distance along the light in z
+		const glm::mat4& Transform() const { return m_transform; }
+		//World size of a texel
+		float TexelSize() const { return m_texelSize; }
+
+		static const int RowsPerFrame = 64;
+
+	private:
+		RenderTarget m_target;
+		int m_resolution, m_row;
+		glm::mat4 m_transform;
+		float m_texelSize;
+		glm::vec3 m_lightDir, m_sceneMin, m_sceneMax;
+		float m_extent;
+	};
+}
@@ -0,0 +1,225 @@
+#include "SparseVolume.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "glm/gtc/packing.hpp"
+#include "../MappedFile.h"
+
+namespace marcher {
+	SparseVolume::SparseVolume()
+		: m_index(0), m_atlas(0), m_dimensions(0), m_brickCount(0), m_min(0.f), m_max(0.f), m_band(0.f), m_slots(0), m_resident(0), m_wideIndex(false) {
+
+	}
+
+	bool SparseVolume::LoadModel(const std::string& path, float bandVoxels) {
+		std::string inputfile = "Resources/Models/" + path;
+
+		MappedFile file;
+		if (!file.Open(inputfile)) {
+			std::printf("Failed to open file %s!", inputfile.c_str());
+			return false;
+		}
+
+		if (VolumetricModel::IsBinary(file.Data(), file.Size())) {
+			VolumeHeader header;
+			if (!VolumetricModel::ReadHeader(file.Data(), file.Size(), inputfile, header))
+				return false;
+			glm::ivec3 dimensions((int)header.Dimensions[0], (int)header.Dimensions[1], (int)header.Dimensions[2]);
+			std::vector<glm::vec2> ranges((size_t)header.BrickCount[0] * header.BrickCount[1] * header.BrickCount[2]);
+			std::memcpy(&ranges[0], file.Data() + header.BrickOffset, ranges.size() * sizeof(glm::vec2));
+			Build(file.Data() + header.DataOffset, (VoxelFormat)header.Format, dimensions,
+				glm::vec3(header.Min[0], header.Min[1], header.Min[2]), glm::vec3(header.Max[0], header.Max[1], header.Max[2]), ranges, bandVoxels);
+			return true;
+		}
+
+		glm::ivec3 dimensions, brickCount;
+		std::vector<float> distances;
+		if (!VolumetricModel::ReadText((const char*)file.Data(), file.Size(), inputfile, dimensions, distances))
+			return false;
+		std::vector<glm::vec2> ranges;
+		VolumetricModel::ComputeBrickRanges(distances, dimensions, brickCount, ranges);
+		Build(&distances[0], VOXEL_R32F, dimensions, glm::vec3(0.f), glm::vec3(2.f), ranges, bandVoxels);
+		return true;
+	}
+
+	void SparseVolume::Build(const void* voxels, VoxelFormat format, const glm::ivec3& dimensions, const glm::vec3& min, const glm::vec3& max,
+		const std::vector<glm::vec2>& ranges, float bandVoxels) {
+		m_dimensions = dimensions;
+		m_brickCount = (dimensions + BrickSize - 1) / BrickSize;
+		m_min = min;
+		m_max = max;
+		glm::vec3 voxelSize = (max - min) / glm::vec3(dimensions);
+		m_band = bandVoxels * glm::max(voxelSize.x, glm::max(voxelSize.y, voxelSize.z));
+
+		//A brick only needs its voxels if a lookup in it could land inside the band. Slots have to be counted first,
+		//the entries of the other bricks start after them
+		m_resident = 0;
+		for (size_t i = 0; i < ranges.size(); i++)
+			m_resident += ranges[i].x < m_band && ranges[i].y > -m_band ? 1 : 0;
+		//16 bit entries are kept while they leave at least 2047 bands for the distances
+		m_wideIndex = m_resident > 0xF000;
+		m_entries.resize(ranges.size());
+		uint32_t slot = 0;
+		for (size_t i = 0; i < ranges.size(); i++) {
+			if (ranges[i].x >= m_band)
+				m_entries[i] = DistanceEntry(ranges[i].x);
+			else if (ranges[i].y <= -m_band)
+				m_entries[i] = DistanceEntry(ranges[i].y);
+			else
+				m_entries[i] = slot++;
+		}
+
+		//Slots are stacked as close to a cube as they go, so the atlas' longest side stays as short as it can under the 3D texture size limit
+		int side = glm::max((int)std::cbrt((double)m_resident), 1);
+		while ((size_t)side * side * side < m_resident)
+			side++;
+		m_slots = glm::ivec3(side, side, (int)glm::max((m_resident + (size_t)side * side - 1) / ((size_t)side * side), (size_t)1));
+		glm::ivec3 size = m_slots * SlotSize;
+		m_texels.assign((size_t)size.x * size.y * size.z, 0);
+
+		const float* floats = (const float*)voxels;
+		const glm::uint16* halves = (const glm::uint16*)voxels;
+		for (int bz = 0; bz < m_brickCount.z; bz++) {
+			for (int by = 0; by < m_brickCount.y; by++) {
+				for (int bx = 0; bx < m_brickCount.x; bx++) {
+					uint32_t entry = m_entries[((size_t)bz * m_brickCount.y + by) * m_brickCount.x + bx];
+					if (entry >= m_resident)
+						continue;
+
+					glm::ivec3 brick = glm::ivec3(bx, by, bz) * BrickSize;
+					glm::ivec3 origin = SlotOrigin(entry);
+					for (int z = 0; z < SlotSize; z++) {
+						for (int y = 0; y < SlotSize; y++) {
+							for (int x = 0; x < SlotSize; x++) {
+								//Aprons past the volume's far faces repeat its last voxels, like the dense texture's clamp to edge
+								glm::ivec3 voxel = glm::min(brick + glm::ivec3(x, y, z), dimensions - 1);
+								size_t i = ((size_t)voxel.z * dimensions.y + voxel.y) * dimensions.x + voxel.x;
+								float distance = format == VOXEL_R16F ? glm::unpackHalf1x16(halves[i]) : floats[i];
+								//Truncating rounds towards zero, so the stored distance is never further from the surface than the real one
+								glm::ivec3 texel = origin + glm::ivec3(x, y, z);
+								m_texels[((size_t)texel.z * size.y + texel.y) * size.x + texel.x] = (int8_t)(glm::clamp(distance / m_band, -1.f, 1.f) * 127.f);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	uint32_t SparseVolume::DistanceEntry(float distance) const {
+		//32 bit entries stop counting where a float still holds the count exactly
+		uint32_t codes = m_wideIndex ? 1u << 25 : 0x10000u - (uint32_t)m_resident;
+		uint32_t bands = (uint32_t)glm::min(std::floor(std::fabs(distance) / m_band), (float)(codes / 2 - 1));
+		return (uint32_t)m_resident + (bands << 1) + (distance < 0.f ? 1u : 0u);
+	}
+
+	glm::ivec3 SparseVolume::SlotOrigin(uint32_t slot) const {
+		return glm::ivec3(slot % m_slots.x, (slot / m_slots.x) % m_slots.y, slot / (m_slots.x * m_slots.y)) * SlotSize;
+	}
+
+	float SparseVolume::AtlasTexel(const glm::ivec3& texel) const {
+		glm::ivec3 size = m_slots * SlotSize;
+		//How GL turns a snorm byte back into a float
+		return glm::max(m_texels[((size_t)texel.z * size.y + texel.y) * size.x + texel.x] / 127.f, -1.f);
+	}
+
+	float SparseVolume::Sample(const glm::vec3& p) const {
+		glm::vec3 voxel = glm::clamp((p - m_min) / (m_max - m_min) * glm::vec3(m_dimensions) - 0.5f, glm::vec3(0.f), glm::vec3(m_dimensions - 1));
+		glm::ivec3 brick = glm::ivec3(voxel) / BrickSize;
+		uint32_t entry = m_entries[((size_t)brick.z * m_brickCount.y + brick.y) * m_brickCount.x + brick.x];
+		if (entry >= m_resident) {
+			uint32_t code = entry - (uint32_t)m_resident;
+			return (code & 1u ? -1.f : 1.f) * (float)(code >> 1) * m_band;
+		}
+
+		glm::vec3 local = voxel - glm::vec3(brick * BrickSize);
+		glm::ivec3 base = glm::ivec3(local);
+		glm::vec3 f = local - glm::vec3(base);
+		base += SlotOrigin(entry);
+		float corners[8];
+		for (int i = 0; i < 8; i++)
+			corners[i] = AtlasTexel(base + glm::ivec3(i & 1, (i >> 1) & 1, i >> 2));
+		float y0 = glm::mix(glm::mix(corners[0], corners[1], f.x), glm::mix(corners[2], corners[3], f.x), f.y);
+		float y1 = glm::mix(glm::mix(corners[4], corners[5], f.x), glm::mix(corners[6], corners[7], f.x), f.y);
+		return glm::mix(y0, y1, f.z) * m_band;
+	}
+
+	bool SparseVolume::Upload() {
+		glm::ivec3 size = m_slots * SlotSize;
+		GLint maxSize = 0;
+		glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxSize);
+		if (m_entries.empty() || glm::max(size.x, size.z) > maxSize || glm::max(m_brickCount.x, glm::max(m_brickCount.y, m_brickCount.z)) > maxSize) {
+			std::printf("A sparse volume with %zu bricks needs a %dx%dx%d atlas, more than the %d a side this GPU takes\n",
+				m_resident, size.x, size.y, size.z, maxSize);
+			return false;
+		}
+
+		if (!m_index)
+			glGenTextures(1, &m_index);
+		if (!m_atlas)
+			glGenTextures(1, &m_atlas);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+		//Integer textures can't be filtered, the index is only ever fetched
+		glBindTexture(GL_TEXTURE_3D, m_index);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		if (m_wideIndex) {
+			glTexImage3D(GL_TEXTURE_3D, 0, GL_R32UI, m_brickCount.x, m_brickCount.y, m_brickCount.z, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, &m_entries[0]);
+		}
+		else {
+			std::vector<uint16_t> entries(m_entries.begin(), m_entries.end());
+			glTexImage3D(GL_TEXTURE_3D, 0, GL_R16UI, m_brickCount.x, m_brickCount.y, m_brickCount.z, 0, GL_RED_INTEGER, GL_UNSIGNED_SHORT, &entries[0]);
+		}
+
+		glBindTexture(GL_TEXTURE_3D, m_atlas);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		glTexImage3D(GL_TEXTURE_3D, 0, GL_R8_SNORM, size.x, size.y, size.z, 0, GL_RED, GL_BYTE, &m_texels[0]);
+		glBindTexture(GL_TEXTURE_3D, 0);
+		return true;
+	}
+
+	void SparseVolume::Bind(int indexUnit, int atlasUnit) {
+		glActiveTexture(GL_TEXTURE0 + indexUnit);
+		glBindTexture(GL_TEXTURE_3D, m_index);
+		glActiveTexture(GL_TEXTURE0 + atlasUnit);
+		glBindTexture(GL_TEXTURE_3D, m_atlas);
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	void SparseVolume::SendUniforms(std::shared_ptr<Shader> shader, int indexUnit, int atlasUnit) const {
+		shader->SendUniform("SparseIndex", indexUnit);
+		shader->SendUniform("SparseAtlas", atlasUnit);
+		shader->SendUniform("SparseMin", m_min);
+		shader->SendUniform("SparseMax", m_max);
+		shader->SendUniform("SparseDimensions", m_dimensions);
+		shader->SendUniform("SparseSlots", glm::ivec2(m_slots));
+		shader->SendUniform("SparseBand", m_band);
+		shader->SendUniform("SparseResident", (int)m_resident);
+	}
+
+	size_t SparseVolume::Bytes() const {
+		return m_entries.size() * (m_wideIndex ? sizeof(uint32_t) : sizeof(uint16_t)) + m_texels.size();
+	}
+
+	size_t SparseVolume::DenseBytes() const {
+		return (size_t)m_dimensions.x * m_dimensions.y * m_dimensions.z * sizeof(glm::uint16);
+	}
+
+	SparseVolume::~SparseVolume() {
+		//Volumes that were only built for the CPU sampler never touched GL
+		if (m_index)
+			glDeleteTextures(1, &m_index);
+		if (m_atlas)
+			glDeleteTextures(1, &m_atlas);
+	}
+}
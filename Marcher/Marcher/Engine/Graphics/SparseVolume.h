@@ -0,0 +1,87 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../Maths.h"
+#include "Shader.h"
+#include "VolumetricModel.h"
+
+/*
+	A distance volume that only keeps its full resolution near the surface.
+	An index holds one entry per brick of the BrickSize^3 voxels VolumetricModel keeps ranges for. Bricks with distances inside the band
+	get a slot in an atlas, where they're stored as 8 bit fractions of the band along with the voxels after them, so a trilinear lookup
+	never has to leave the slot. Every other brick's entry is just how many whole bands its lookups stay from the surface.
+	Within half a band of the surface lookups stay within a step of the atlas of the dense volume. Further out they blend in voxels clamped to
+	the band, so they can come out up to a quarter voxel nearer to zero. Either way the distance is never further from zero than the dense
+	volume's by more than a step of the atlas, so sphere tracing it stays safe.
+*/
+
+namespace marcher {
+	class SparseVolume {
+	public:
+		SparseVolume();
+
+		//Loads a text or binary volume from Resources/Models. Binary ones are read straight from their mapping and only the voxels of
+		//bricks in the band get touched, so the dense volume never has to fit in memory. bandVoxels is the band's half width in voxels
+		bool LoadModel(const std::string& path, float bandVoxels = DefaultBand);
+		//voxels are dimensions x*y*z distances of format covering min to max, x fastest, and ranges are their bricks' ranges
+		//as VolumetricModel::ComputeBrickRanges() gives them
+		void Build(const void* voxels, VoxelFormat format, const glm::ivec3& dimensions, const glm::vec3& min, const glm::vec3& max,
+			const std::vector<glm::vec2>& ranges, float bandVoxels = DefaultBand);
+
+		//Creates the index and atlas textures, or refills them after another Build(). False if the atlas is too big for the GPU
+		bool Upload();
+		void Bind(int indexUnit, int atlasUnit);
+		//Sends the Sparse uniforms, with the textures bound to indexUnit and atlasUnit
+		void SendUniforms(std::shared_ptr<Shader> shader, int indexUnit, int atlasUnit) const;
+
+		//The same lookup as SparseDistance() in the shader, points outside the volume get the distance at its nearest voxel
+		float Sample(const glm::vec3& p) const;
+
+		const glm::ivec3& Dimensions() const { return m_dimensions; }
+		const glm::vec3& Min() const { return m_min; }
+		const glm::vec3& Max() const { return m_max; }
+		float Band() const { return m_band; }
+		size_t BrickCount() const { return m_entries.size(); }
+		size_t ResidentBricks() const { return m_resident; }
+		//Whether the index needs 32 bit entries, it only does with too many bricks in the band for 16
+		bool WideIndex() const { return m_wideIndex; }
+		//What the index and atlas take up on the GPU, and what VolumetricModel's dense R16F texture of the same volume would
+		size_t Bytes() const;
+		size_t DenseBytes() const;
+
+		~SparseVolume();
+
+		static const int BrickSize = VolumetricModel::BrickSize;
+		//A slot holds a brick and the voxels after it
+		static const int SlotSize = BrickSize + 1;
+		static constexpr float DefaultBand = 2.f;
+
+	private:
+		SparseVolume(const SparseVolume&) = delete;
+		SparseVolume& operator=(const SparseVolume&) = delete;
+
+		//Entries below m_resident are slots. The ones above are m_resident plus the number of whole bands the distance is from zero,
+		//doubled and with the low bit set when it's negative. The count is rounded down and clamped to what the entries can hold
+		uint32_t DistanceEntry(float distance) const;
+		//First texel of a slot in the atlas
+		glm::ivec3 SlotOrigin(uint32_t slot) const;
+		float AtlasTexel(const glm::ivec3& texel) const;
+
+		GLuint m_index, m_atlas;
+		glm::ivec3 m_dimensions, m_brickCount;
+		glm::vec3 m_min, m_max;
+		//The distance the atlas' -1 and 1 stand for
+		float m_band;
+		//Slots along each side of the atlas, it's SlotSize texels per slot
+		glm::ivec3 m_slots;
+		size_t m_resident;
+		bool m_wideIndex;
+		std::vector<uint32_t> m_entries;
+		std::vector<int8_t> m_texels;
+	};
+}
@@ -0,0 +1,98 @@
+#include "TiledRenderer.h"
+
+#include "../Sampling.h"
+
+namespace marcher {
+	TiledRenderer::TiledRenderer(int tileWidth, int tileHeight)
+		: m_tileWidth(tileWidth), m_tileHeight(tileHeight) {
+		//Samples are summed with additive blending, so the target needs to be float
+		glGenTextures(1, &m_texture);
+		glBindTexture(GL_TEXTURE_2D, m_texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, tileWidth, tileHeight, 0, GL_RGBA, GL_FLOAT, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glGenFramebuffers(1, &m_framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			printf("Tile framebuffer is incomplete\n");
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		float vertices[] = {
+			-1.f, -1.f, 0.f,
+			-1.f,  1.f, 0.f,
+			 1.f,  1.f, 0.f,
+			 1.f,  1.f, 0.f,
+			 1.f, -1.f, 0.f,
+			-1.f, -1.f, 0.f
+		};
+
+		glGenVertexArrays(1, &m_VAO);
+		glGenBuffers(1, &m_VBO);
+		glBindVertexArray(m_VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindVertexArray(0);
+
+		m_readback.resize((size_t)tileWidth * tileHeight * 3);
+	}
+
+	void TiledRenderer::RenderRegion(std::shared_ptr<Shader> shader, const Camera& camera, int width, int height, glm::ivec4 region, glm::vec3* pixels, int samples) {
+		samples = glm::max(samples, 1);
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		shader->Bind();
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+		glBindVertexArray(m_VAO);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_ONE, GL_ONE);
+		glClearColor(0.f, 0.f, 0.f, 0.f);
+
+		for (int ty = 0; ty < region.w; ty += m_tileHeight) {
+			for (int tx = 0; tx < region.z; tx += m_tileWidth) {
+				int tileWidth = glm::min(m_tileWidth, region.z - tx);
+				int tileHeight = glm::min(m_tileHeight, region.w - ty);
+				//The tile's bottom left pixel in gl_FragCoord orientation
+				glm::vec2 origin = glm::vec2(region.x + tx, height - (region.y + ty + tileHeight));
+
+				glViewport(0, 0, tileWidth, tileHeight);
+				glClear(GL_COLOR_BUFFER_BIT);
+				shader->SendUniform("ScreenSize", glm::vec2(tileWidth, tileHeight));
+				for (int s = 0; s < samples; s++) {
+					//Shifting the corners moves every fragment of the tile by the same sub-pixel offset
+					glm::vec2 from = (origin + SampleOffset(s, samples) - glm::vec2(0.5f)) / glm::vec2(width, height);
+					glm::vec2 to = from + glm::vec2(tileWidth, tileHeight) / glm::vec2(width, height);
+					camera.SendUniforms(shader, from, to);
+					glDrawArrays(GL_TRIANGLES, 0, 6);
+				}
+
+				glPixelStorei(GL_PACK_ALIGNMENT, 1);
+				glReadPixels(0, 0, tileWidth, tileHeight, GL_RGB, GL_FLOAT, &m_readback[0]);
+				for (int y = 0; y < tileHeight; y++) {
+					//glReadPixels returns the bottom row first
+					const float* row = &m_readback[(size_t)(tileHeight - 1 - y) * tileWidth * 3];
+					glm::vec3* out = pixels + (size_t)(ty + y) * region.z + tx;
+					for (int x = 0; x < tileWidth; x++)
+						out[x] = glm::vec3(row[x * 3], row[x * 3 + 1], row[x * 3 + 2]) / (float)samples;
+				}
+			}
+		}
+
+		glDisable(GL_BLEND);
+		glBindVertexArray(0);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	}
+
+	TiledRenderer::~TiledRenderer() {
+		glDeleteVertexArrays(1, &m_VAO);
+		glDeleteBuffers(1, &m_VBO);
+		glDeleteFramebuffers(1, &m_framebuffer);
+		glDeleteTextures(1, &m_texture);
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <memory>
+#include <vector>
+
+#include "../Maths.h"
+#include "Shader.h"
+#include "Camera.h"
+
+/*
+	Renders parts of an image that can be far bigger than the window or the maximum texture size, one framebuffer sized tile at a time.
+	Each tile is drawn with the camera corners narrowed to its part of the screen, so the rays match a single full size draw.
+*/
+
+namespace marcher {
+	class TiledRenderer {
+	public:
+		TiledRenderer(int tileWidth = 1024, int tileHeight = 256);
+
+		//Renders region (x, y, width, height with y counted from the top) of a width*height image into pixels, top row first.
+		//Every uniform apart from the camera and ScreenSize has to be sent to the shader beforehand.
+		//Multiple samples are jittered inside each pixel and averaged
+		void RenderRegion(std::shared_ptr<Shader> shader, const Camera& camera, int width, int height, glm::ivec4 region, glm::vec3* pixels, int samples = 1);
+
+		~TiledRenderer();
+
+	private:
+		int m_tileWidth, m_tileHeight;
+		GLuint m_framebuffer, m_texture;
+		GLuint m_VAO, m_VBO;
+		std::vector<float> m_readback;
+	};
+}
@@ -1,32 +1,300 @@
 #include "VolumetricModel.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cfloat>
+#include <charconv>
+#include <cstring>
+#include <thread>
+
+#include "glm/gtc/packing.hpp"
+#include "../MappedFile.h"
+
 namespace marcher {
-	VolumetricModel::VolumetricModel(std::string path = "-") : m_handle(0) {
+	namespace {
+		const char VolumeMagic[4] = { 'M', 'V', 'O', 'L' };
+		const uint32_t VolumeVersion = 2;
+		//Voxels start on a cache line of their own
+		const uint64_t DataAlignment = 64;
+		static_assert(sizeof(VolumeHeader) == 80, "VolumeHeader has to match the file layout byte for byte");
+		//Longest side a binary volume may claim
+		const uint32_t MaxSide = 1 << 16;
+
+		size_t VoxelBytes(uint32_t format) {
+			return format == VOXEL_R16F ? 2 : 4;
+		}
+
+		//Text volumes are split over threads in chunks of at least this many bytes
+		const size_t MinChunkBytes = 1 << 20;
+
+		//A run of whole lines of a text volume and where its values go
+		struct TextChunk {
+			const char* Begin;
+			const char* End;
+			size_t Values, First;
+			bool Parsed;
+		};
+
+		//A line holds a value unless it's empty, which is what getline() and skipping "" lines used to do. Windows line endings count as empty
+		const char* LineEnd(const char* line, const char* end, bool& empty) {
+			const char* newline = (const char*)std::memchr(line, '\n', end - line);
+			const char* lineEnd = newline ? newline : end;
+			empty = lineEnd == line || (lineEnd - line == 1 && *line == '\r');
+			return lineEnd;
+		}
+
+		void CountValues(TextChunk& chunk) {
+			chunk.Values = 0;
+			for (const char* line = chunk.Begin; line < chunk.End;) {
+				bool empty;
+				const char* lineEnd = LineEnd(line, chunk.End, empty);
+				chunk.Values += empty ? 0 : 1;
+				line = lineEnd + 1;
+			}
+		}
+
+		//Reads what stof() would from the start of a line: blanks, a sign, then a decimal or 0x hex float, with anything after it ignored.
+		//from_chars takes neither the + nor the 0x, so they're handled here
+		bool ParseValue(const char* value, const char* end, float& out) {
+			while (value < end && std::isspace((unsigned char)*value))
+				value++;
+			bool negative = value < end && *value == '-';
+			if (value < end && (*value == '+' || *value == '-'))
+				value++;
+			if (value < end && (*value == '+' || *value == '-'))
+				return false;
+			std::chars_format format = std::chars_format::general;
+			if (end - value > 2 && value[0] == '0' && (value[1] == 'x' || value[1] == 'X') && (std::isxdigit((unsigned char)value[2]) || value[2] == '.')) {
+				value += 2;
+				format = std::chars_format::hex;
+			}
+			if (std::from_chars(value, end, out, format).ec != std::errc())
+				return false;
+			out = negative ? -out : out;
+			return true;
+		}
+
+		void ParseValues(TextChunk& chunk, float* out) {
+			chunk.Parsed = true;
+			for (const char* line = chunk.Begin; line < chunk.End;) {
+				bool empty;
+				const char* lineEnd = LineEnd(line, chunk.End, empty);
+				if (!empty && !ParseValue(line, lineEnd, *out++))
+					chunk.Parsed = false;
+				line = lineEnd + 1;
+			}
+		}
+
+		//Runs work on every chunk at once, the calling thread takes the first one
+		template<class Work>
+		void ForEachChunk(std::vector<TextChunk>& chunks, Work work) {
+			std::vector<std::thread> threads;
+			for (size_t i = 1; i < chunks.size(); i++)
+				threads.push_back(std::thread(work, std::ref(chunks[i])));
+			work(chunks[0]);
+			for (size_t i = 0; i < threads.size(); i++)
+				threads[i].join();
+		}
+	}
+
+	VolumetricModel::VolumetricModel(std::string path = "-")
+		: m_handle(0), m_dimensions(0), m_brickCount(0), m_min(0.f), m_max(0.f) {
 		if (path != "-")
 			LoadModel(path);
 	}
 
 	void VolumetricModel::LoadModel(std::string path) {
 		std::string inputfile = "Resources/Models/"+path;
-		std::ifstream file(inputfile);
+
+		MappedFile file;
+		if (!file.Open(inputfile)) {
+			std::printf("Failed to open file %s!", inputfile.c_str());
+			return;
+		}
+		if (IsBinary(file.Data(), file.Size())) {
+			LoadBinary(file.Data(), file.Size(), inputfile);
+			return;
+		}
 
 		std::vector<float> distanceField;
+		if (!ReadText((const char*)file.Data(), file.Size(), inputfile, m_dimensions, distanceField))
+			return;
+		m_min = glm::vec3(0.f);
+		m_max = glm::vec3(2.f);
+		ComputeBrickRanges(distanceField, m_dimensions, m_brickCount, m_brickRanges);
+		Upload(GL_FLOAT, &distanceField[0]);
+	}
+
+	bool VolumetricModel::ReadText(const char* text, size_t size, const std::string& path, glm::ivec3& dimensions, std::vector<float>& distances) {
+		const char* end = text + size;
+		const char* cursor = text;
+		while (cursor < end && std::isspace((unsigned char)*cursor))
+			cursor++;
 		float VOXELSIZE = 1;
-		std::string line;
-		if (file.is_open()) {
-			file >> VOXELSIZE;
-			while (std::getline(file, line)) {
-				if (line != "") {					
-					float lval = stof(line);
-					distanceField.push_back(lval);
-					//distanceField.push_back(lval);
+		cursor = std::from_chars(cursor, end, VOXELSIZE).ptr;
+		dimensions = glm::ivec3((int)(2 / VOXELSIZE + 0.5f));
+		size_t expected = (size_t)dimensions.x * dimensions.y * dimensions.z;
+
+		//Chunks start where the last one ended and end just after a newline, whatever follows the voxel size on its line counts as a line of its own
+		size_t chunkCount = std::max<size_t>(std::min<size_t>(std::thread::hardware_concurrency(), (end - cursor) / MinChunkBytes), 1);
+		std::vector<TextChunk> chunks(chunkCount);
+		for (size_t i = 0; i < chunkCount; i++) {
+			chunks[i].Begin = i == 0 ? cursor : chunks[i - 1].End;
+			const char* target = std::max(chunks[i].Begin, cursor + (end - cursor) * (i + 1) / chunkCount);
+			const char* newline = i + 1 == chunkCount ? nullptr : (const char*)std::memchr(target, '\n', end - target);
+			chunks[i].End = newline ? newline + 1 : end;
+		}
+
+		//Counting the values first gives each chunk its place in the buffer, so they're parsed straight into it
+		ForEachChunk(chunks, CountValues);
+		size_t total = 0;
+		for (size_t i = 0; i < chunkCount; i++) {
+			chunks[i].First = total;
+			total += chunks[i].Values;
+		}
+		if (total == 0 || total != expected) {
+			std::printf("%s holds %zu distances, a voxel size of %f needs %d^3\n", path.c_str(), total, VOXELSIZE, dimensions.x);
+			return false;
+		}
+
+		distances.resize(total);
+		float* out = &distances[0];
+		ForEachChunk(chunks, [out](TextChunk& chunk) { ParseValues(chunk, out + chunk.First); });
+		for (size_t i = 0; i < chunkCount; i++) {
+			if (!chunks[i].Parsed) {
+				std::printf("%s has a line that isn't a distance\n", path.c_str());
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void VolumetricModel::ComputeBrickRanges(const std::vector<float>& distances, const glm::ivec3& dimensions, glm::ivec3& brickCount, std::vector<glm::vec2>& ranges) {
+		brickCount = (dimensions + BrickSize - 1) / BrickSize;
+		ranges.assign((size_t)brickCount.x * brickCount.y * brickCount.z, glm::vec2(FLT_MAX, -FLT_MAX));
+		for (int z = 0; z < dimensions.z; z++) {
+			for (int y = 0; y < dimensions.y; y++) {
+				for (int x = 0; x < dimensions.x; x++) {
+					float distance = distances[((size_t)z * dimensions.y + y) * dimensions.x + x];
+					//A voxel on a brick's near face is also the far apron of the brick before it
+					glm::ivec3 voxel(x, y, z);
+					glm::ivec3 first = glm::max((voxel - 1) / BrickSize, glm::ivec3(0));
+					glm::ivec3 last = voxel / BrickSize;
+					for (int bz = first.z; bz <= last.z; bz++) {
+						for (int by = first.y; by <= last.y; by++) {
+							for (int bx = first.x; bx <= last.x; bx++) {
+								glm::vec2& range = ranges[((size_t)bz * brickCount.y + by) * brickCount.x + bx];
+								range = glm::vec2(glm::min(range.x, distance), glm::max(range.y, distance));
+							}
+						}
+					}
 				}
 			}
-			file.close();
 		}
-		else std::printf("Failed to open file %s!", inputfile.c_str());
+	}
+
+	bool VolumetricModel::IsBinary(const unsigned char* data, size_t size) {
+		return size >= sizeof(VolumeHeader) && std::memcmp(data, VolumeMagic, sizeof(VolumeMagic)) == 0;
+	}
+
+	bool VolumetricModel::ReadHeader(const unsigned char* data, size_t size, const std::string& path, VolumeHeader& header) {
+		std::memcpy(&header, data, sizeof(header));
+
+		//Sides are capped so the counts below can't wrap, and the offsets are checked before anything is added to them
+		bool bricksCover = header.BrickSize == BrickSize;
+		for (int i = 0; i < 3; i++)
+			bricksCover = bricksCover && header.Dimensions[i] <= MaxSide && header.BrickCount[i] == (header.Dimensions[i] + BrickSize - 1) / BrickSize;
+		size_t voxels = (size_t)header.Dimensions[0] * header.Dimensions[1] * header.Dimensions[2];
+		size_t bricks = (size_t)header.BrickCount[0] * header.BrickCount[1] * header.BrickCount[2];
+		if (header.Version != VolumeVersion || header.Format > VOXEL_R16F || !bricksCover || voxels == 0
+			|| header.BrickOffset > size || bricks > (size - header.BrickOffset) / sizeof(glm::vec2)
+			|| header.DataOffset > size || voxels > (size - header.DataOffset) / VoxelBytes(header.Format)) {
+			std::printf("%s isn't a valid v2 volume\n", path.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	bool VolumetricModel::LoadBinary(const unsigned char* data, size_t size, const std::string& path) {
+		VolumeHeader header;
+		if (!ReadHeader(data, size, path, header))
+			return false;
+
+		m_dimensions = glm::ivec3((int)header.Dimensions[0], (int)header.Dimensions[1], (int)header.Dimensions[2]);
+		m_brickCount = glm::ivec3((int)header.BrickCount[0], (int)header.BrickCount[1], (int)header.BrickCount[2]);
+		size_t bricks = (size_t)m_brickCount.x * m_brickCount.y * m_brickCount.z;
+		m_min = glm::vec3(header.Min[0], header.Min[1], header.Min[2]);
+		m_max = glm::vec3(header.Max[0], header.Max[1], header.Max[2]);
+		m_brickRanges.resize(bricks);
+		if (bricks > 0)
+			std::memcpy(&m_brickRanges[0], data + header.BrickOffset, bricks * sizeof(glm::vec2));
+
+		//Straight from the mapping, the driver reads the pages in as it copies them
+		Upload(header.Format == VOXEL_R16F ? GL_HALF_FLOAT : GL_FLOAT, data + header.DataOffset);
+		return true;
+	}
+
+	bool VolumetricModel::Convert(const std::string& textPath, const std::string& binaryPath, VoxelFormat format) {
+		MappedFile text;
+		if (!text.Open(textPath)) {
+			std::printf("Failed to open file %s!", textPath.c_str());
+			return false;
+		}
+		glm::ivec3 dimensions;
+		std::vector<float> distances;
+		if (!ReadText((const char*)text.Data(), text.Size(), textPath, dimensions, distances))
+			return false;
+		text.Close();
+		//The ranges have to hold the values as they're stored, a half can round past the float it came from
+		std::vector<glm::uint16> halves;
+		if (format == VOXEL_R16F) {
+			halves.resize(distances.size());
+			for (size_t i = 0; i < distances.size(); i++) {
+				halves[i] = glm::packHalf1x16(distances[i]);
+				distances[i] = glm::unpackHalf1x16(halves[i]);
+			}
+		}
+		glm::ivec3 brickCount;
+		std::vector<glm::vec2> ranges;
+		ComputeBrickRanges(distances, dimensions, brickCount, ranges);
+
+		VolumeHeader header = {};
+		std::memcpy(header.Magic, VolumeMagic, sizeof(VolumeMagic));
+		header.Version = VolumeVersion;
+		header.Format = format;
+		for (int i = 0; i < 3; i++) {
+			header.Dimensions[i] = (uint32_t)dimensions[i];
+			header.BrickCount[i] = (uint32_t)brickCount[i];
+			header.Min[i] = 0.f;
+			header.Max[i] = 2.f;
+		}
+		header.BrickSize = BrickSize;
+		header.BrickOffset = sizeof(VolumeHeader);
+		header.DataOffset = (header.BrickOffset + ranges.size() * sizeof(glm::vec2) + DataAlignment - 1) / DataAlignment * DataAlignment;
 
-		glGenTextures(1, &m_handle);
+		std::ofstream file(binaryPath, std::ofstream::binary);
+		if (!file.is_open()) {
+			std::printf("Failed to open file %s!", binaryPath.c_str());
+			return false;
+		}
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)&ranges[0], ranges.size() * sizeof(glm::vec2));
+		std::vector<char> padding((size_t)(header.DataOffset - header.BrickOffset - ranges.size() * sizeof(glm::vec2)), 0);
+		if (!padding.empty())
+			file.write(&padding[0], padding.size());
+
+		if (format == VOXEL_R16F) {
+			file.write((const char*)&halves[0], halves.size() * sizeof(glm::uint16));
+		}
+		else {
+			file.write((const char*)&distances[0], distances.size() * sizeof(float));
+		}
+		return file.good();
+	}
+
+	void VolumetricModel::Upload(GLenum type, const void* voxels) {
+		if (!m_handle)
+			glGenTextures(1, &m_handle);
 		glBindTexture(GL_TEXTURE_3D, m_handle);
 		
 		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -36,10 +304,14 @@ namespace marcher {
 		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-		glTexImage3D(GL_TEXTURE_3D, 0, GL_R16F, 2 / VOXELSIZE, 2 / VOXELSIZE, 2 / VOXELSIZE, 0, GL_RED, GL_FLOAT, &distanceField[0]);
+		glTexImage3D(GL_TEXTURE_3D, 0, GL_R16F, m_dimensions.x, m_dimensions.y, m_dimensions.z, 0, GL_RED, type, voxels);
 		glBindTexture(GL_TEXTURE_3D, 0);
 	}
 
+	glm::vec2 VolumetricModel::BrickRange(const glm::ivec3& brick) const {
+		return m_brickRanges[((size_t)brick.z * m_brickCount.y + brick.y) * m_brickCount.x + brick.x];
+	}
+
 	void VolumetricModel::Bind(int unit) {
 		if (unit >= 0)
 			glActiveTexture(GL_TEXTURE0 + unit);
@@ -49,4 +321,4 @@ namespace marcher {
 	VolumetricModel::~VolumetricModel() {
 		glDeleteTextures(1, &m_handle);
 	}
-}
\ No newline at end of file
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <glad/glad.h>
+#include <cstdint>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -9,18 +10,73 @@
 #include "../Maths.h"
 #include "Color.h"
 
+/*
+	A distance field sampled on a grid and uploaded as a 3D texture.
+	Text .vol files hold the voxel size and then one distance per line, over a cube from 0 to 2 with x changing fastest.
+	Binary v2 files hold a VolumeHeader and the voxels as they go to the GPU, they're mapped and uploaded without any parsing.
+	Convert() turns the first into the second.
+*/
+
 namespace marcher {
+	enum VoxelFormat {
+		VOXEL_R32F,
+		VOXEL_R16F
+	};
+
+	//Binary volumes start with this, followed by BrickCount x*y*z (min, max) float pairs from BrickOffset on, x fastest,
+	//then the voxels from DataOffset on, x fastest too. Everything is little endian
+	struct VolumeHeader {
+		char Magic[4];
+		uint32_t Version;
+		uint32_t Dimensions[3];
+		uint32_t Format;
+		float Min[3], Max[3];
+		uint32_t BrickSize;
+		uint32_t BrickCount[3];
+		uint64_t BrickOffset, DataOffset;
+	};
+
 	class VolumetricModel {
 	public:
 		VolumetricModel(std::string path);
 
+		//Loads a model from Resources/Models, binary files are told apart from text ones by their magic
 		void LoadModel(std::string path);
 		void Bind(int unit = -1);
 
+		const glm::ivec3& Dimensions() const { return m_dimensions; }
+		//The box the voxels cover
+		const glm::vec3& Min() const { return m_min; }
+		const glm::vec3& Max() const { return m_max; }
+		const glm::ivec3& BrickCount() const { return m_brickCount; }
+		//Smallest and largest distance a trilinear lookup inside brick can return
+		glm::vec2 BrickRange(const glm::ivec3& brick) const;
+
+		//Writes a text volume out as a binary v2 one with its voxels stored as format
+		static bool Convert(const std::string& textPath, const std::string& binaryPath, VoxelFormat format = VOXEL_R16F);
+
+		//Whether a file starts with the binary magic
+		static bool IsBinary(const unsigned char* data, size_t size);
+		//Copies out a binary volume's header, fails unless its bricks and voxels fit in size bytes. path is only for the error messages
+		static bool ReadHeader(const unsigned char* data, size_t size, const std::string& path, VolumeHeader& header);
+		//Parses a text volume's size bytes on as many threads as there are cores, fails unless it holds a full cube of distances.
+		//path is only for the error messages
+		static bool ReadText(const char* text, size_t size, const std::string& path, glm::ivec3& dimensions, std::vector<float>& distances);
+		//Bounds of each brick's voxels along with the ones after it, which lookups near its far faces blend in
+		static void ComputeBrickRanges(const std::vector<float>& distances, const glm::ivec3& dimensions, glm::ivec3& brickCount, std::vector<glm::vec2>& ranges);
+
+		static const int BrickSize = 8;
+
 		~VolumetricModel();
 
 	private:
+		bool LoadBinary(const unsigned char* data, size_t size, const std::string& path);
+		//type is GL_FLOAT or GL_HALF_FLOAT, the texture is R16F either way
+		void Upload(GLenum type, const void* voxels);
 
 		GLuint m_handle;
+		glm::ivec3 m_dimensions, m_brickCount;
+		glm::vec3 m_min, m_max;
+		std::vector<glm::vec2> m_brickRanges;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+/*
+	64 bit FNV-1a, for telling states apart without keeping a copy of each one around.
+*/
+
+namespace marcher {
+	const unsigned long long HashSeed = 14695981039346656037ull;
+
+	inline unsigned long long HashBytes(const void* data, size_t size, unsigned long long hash = HashSeed) {
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	//Only for types without padding, or the padding bytes get hashed too
+	template<class T>
+	inline unsigned long long HashValue(const T& value, unsigned long long hash = HashSeed) {
+		return HashBytes(&value, sizeof(T), hash);
+	}
+}
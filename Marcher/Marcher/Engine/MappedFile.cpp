@@ -0,0 +1,103 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace marcher {
+#ifdef _WIN32
+	MappedFile::MappedFile()
+		: m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr), m_data(nullptr), m_size(0) {
+	}
+
+	bool MappedFile::Open(const std::string& path) {
+		Close();
+		m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (m_file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_file, &size)) {
+			Close();
+			return false;
+		}
+		m_size = (size_t)size.QuadPart;
+		//Windows can't map an empty file
+		if (m_size == 0)
+			return true;
+
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_mapping)
+			m_data = (const unsigned char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!m_data) {
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void MappedFile::Close() {
+		if (m_data)
+			UnmapViewOfFile(m_data);
+		if (m_mapping)
+			CloseHandle(m_mapping);
+		if (m_file != INVALID_HANDLE_VALUE)
+			CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+		m_mapping = nullptr;
+		m_data = nullptr;
+		m_size = 0;
+	}
+#else
+	MappedFile::MappedFile()
+		: m_file(-1), m_data(nullptr), m_size(0) {
+	}
+
+	bool MappedFile::Open(const std::string& path) {
+		Close();
+		m_file = open(path.c_str(), O_RDONLY);
+		if (m_file < 0)
+			return false;
+
+		struct stat info;
+		if (fstat(m_file, &info) != 0) {
+			Close();
+			return false;
+		}
+		m_size = (size_t)info.st_size;
+		if (m_size == 0)
+			return true;
+
+		void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+		if (data == MAP_FAILED) {
+			Close();
+			return false;
+		}
+		//The whole file is about to be read front to back
+		madvise(data, m_size, MADV_SEQUENTIAL);
+		m_data = (const unsigned char*)data;
+		return true;
+	}
+
+	void MappedFile::Close() {
+		if (m_data)
+			munmap((void*)m_data, m_size);
+		if (m_file >= 0)
+			close(m_file);
+		m_file = -1;
+		m_data = nullptr;
+		m_size = 0;
+	}
+#endif
+
+	MappedFile::~MappedFile() {
+		Close();
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/*
+	A whole file mapped read only into memory. Nothing is read up front, the OS pages the file in as the mapping gets touched,
+	so a loader can hand pointers into it straight to the GPU without copying the file anywhere first.
+*/
+
+namespace marcher {
+	class MappedFile {
+	public:
+		MappedFile();
+		~MappedFile();
+
+		//Maps path, closing whatever was mapped before. An empty file opens fine with a null Data()
+		bool Open(const std::string& path);
+		void Close();
+
+		const unsigned char* Data() const { return m_data; }
+		size_t Size() const { return m_size; }
+
+	private:
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+#ifdef _WIN32
+		void* m_file;
+		void* m_mapping;
+#else
+		int m_file;
+#endif
+		const unsigned char* m_data;
+		size_t m_size;
+	};
+}
@@ -0,0 +1,139 @@
+#include "PngWriter.h"
+
+namespace marcher {
+	namespace {
+		unsigned int CRCTable[256];
+		bool CRCTableReady = false;
+
+		unsigned int UpdateCRC(unsigned int crc, const unsigned char* data, size_t length) {
+			if (!CRCTableReady) {
+				for (unsigned int n = 0; n < 256; n++) {
+					unsigned int c = n;
+					for (int k = 0; k < 8; k++)
+						c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+					CRCTable[n] = c;
+				}
+				CRCTableReady = true;
+			}
+			for (size_t i = 0; i < length; i++)
+				crc = CRCTable[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+			return crc;
+		}
+
+		void PushBE32(std::vector<unsigned char>& out, unsigned int value) {
+			out.push_back((unsigned char)(value >> 24));
+			out.push_back((unsigned char)(value >> 16));
+			out.push_back((unsigned char)(value >> 8));
+			out.push_back((unsigned char)value);
+		}
+
+		const size_t MaxStoredBlock = 65535;
+	}
+
+	PngWriter::PngWriter() : m_width(0), m_height(0), m_rowsWritten(0), m_adlerA(1), m_adlerB(0) {
+
+	}
+
+	PngWriter::~PngWriter() {
+		if (m_file.is_open())
+			Close();
+	}
+
+	bool PngWriter::Open(const std::string& path, int width, int height) {
+		m_file.open(path, std::ofstream::out | std::ofstream::binary);
+		if (!m_file.is_open()) {
+			std::printf("Failed to open file %s!\n", path.c_str());
+			return false;
+		}
+		m_width = width;
+		m_height = height;
+		m_rowsWritten = 0;
+		m_adlerA = 1;
+		m_adlerB = 0;
+		m_block.clear();
+
+		const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+		m_file.write((const char*)signature, 8);
+
+		std::vector<unsigned char> header;
+		PushBE32(header, (unsigned int)width);
+		PushBE32(header, (unsigned int)height);
+		header.push_back(8); //Bit depth
+		header.push_back(2); //Truecolor
+		header.push_back(0); //Deflate
+		header.push_back(0); //Adaptive filtering
+		header.push_back(0); //No interlacing
+		WriteChunk("IHDR", header);
+
+		//The zlib stream header goes out with the first IDAT
+		m_block.reserve(MaxStoredBlock);
+		std::vector<unsigned char> zlibHeader;
+		zlibHeader.push_back(0x78);
+		zlibHeader.push_back(0x01);
+		WriteChunk("IDAT", zlibHeader);
+		return m_file.good();
+	}
+
+	void PngWriter::WriteRows(const unsigned char* rgb, int rows) {
+		std::vector<unsigned char> out;
+		size_t rowBytes = (size_t)m_width * 3;
+		for (int r = 0; r < rows && m_rowsWritten < m_height; r++, m_rowsWritten++) {
+			//Every scanline starts with its filter type, 0 being none
+			const unsigned char filter = 0;
+			const unsigned char* row = rgb + rowBytes * r;
+			for (size_t i = 0; i <= rowBytes; i++) {
+				unsigned char byte = i == 0 ? filter : row[i - 1];
+				m_adlerA = (m_adlerA + byte) % 65521;
+				m_adlerB = (m_adlerB + m_adlerA) % 65521;
+				m_block.push_back(byte);
+				if (m_block.size() == MaxStoredBlock)
+					FlushBlock(false, out);
+			}
+		}
+		if (!out.empty())
+			WriteChunk("IDAT", out);
+	}
+
+	bool PngWriter::Close() {
+		if (!m_file.is_open())
+			return false;
+
+		std::vector<unsigned char> out;
+		FlushBlock(true, out);
+		PushBE32(out, (m_adlerB << 16) | m_adlerA);
+		WriteChunk("IDAT", out);
+		WriteChunk("IEND", std::vector<unsigned char>());
+
+		bool success = m_file.good() && m_rowsWritten == m_height;
+		m_file.close();
+		return success;
+	}
+
+	void PngWriter::WriteChunk(const char* type, const std::vector<unsigned char>& data) {
+		std::vector<unsigned char> length;
+		PushBE32(length, (unsigned int)data.size());
+		m_file.write((const char*)&length[0], 4);
+		m_file.write(type, 4);
+		if (!data.empty())
+			m_file.write((const char*)&data[0], data.size());
+
+		unsigned int crc = UpdateCRC(0xffffffffu, (const unsigned char*)type, 4);
+		if (!data.empty())
+			crc = UpdateCRC(crc, &data[0], data.size());
+		std::vector<unsigned char> crcBytes;
+		PushBE32(crcBytes, crc ^ 0xffffffffu);
+		m_file.write((const char*)&crcBytes[0], 4);
+	}
+
+	void PngWriter::FlushBlock(bool final, std::vector<unsigned char>& out) {
+		//A stored block: header bits, then the length and its complement in little endian
+		unsigned short length = (unsigned short)m_block.size();
+		out.push_back(final ? 1 : 0);
+		out.push_back((unsigned char)(length & 0xff));
+		out.push_back((unsigned char)(length >> 8));
+		out.push_back((unsigned char)(~length & 0xff));
+		out.push_back((unsigned char)((~length >> 8) & 0xff));
+		out.insert(out.end(), m_block.begin(), m_block.end());
+		m_block.clear();
+	}
+}
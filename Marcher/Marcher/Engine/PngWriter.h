@@ -0,0 +1,36 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+/*
+	Writes an 8 bit RGB PNG a few rows at a time, so images far bigger than memory can be saved while they're being rendered.
+	The pixel data is stored in uncompressed deflate blocks to stay free of a zlib dependency, expect files of about width*height*3 bytes.
+*/
+
+namespace marcher {
+	class PngWriter {
+	public:
+		PngWriter();
+		~PngWriter();
+
+		bool Open(const std::string& path, int width, int height);
+		//rgb holds rows*width*3 bytes, top row first. Rows past the height given to Open() are ignored
+		void WriteRows(const unsigned char* rgb, int rows);
+		//Finishes the file, returns false if anything failed or fewer rows than the height were written
+		bool Close();
+
+		int RowsWritten() const { return m_rowsWritten; }
+
+	private:
+		void WriteChunk(const char* type, const std::vector<unsigned char>& data);
+		void FlushBlock(bool final, std::vector<unsigned char>& out);
+
+		std::ofstream m_file;
+		int m_width, m_height, m_rowsWritten;
+		unsigned int m_adlerA, m_adlerB;
+		//Filtered scanline bytes waiting for a full 65535 byte stored block
+		std::vector<unsigned char> m_block;
+	};
+}
@@ -0,0 +1,325 @@
+#include "CodeGen.h"
+
+#include <cstdio>
+#include <sstream>
+
+namespace marcher {
+	namespace sdf {
+		namespace {
+			//The bits of syntax that differ between the two languages, everything is emitted as scalar float code
+			struct Dialect {
+				const char* Sqrt;
+				const char* Abs;
+				const char* Floor;
+				const char* Min;
+				const char* Max;
+				const char* FloatSuffix;
+			};
+
+			const Dialect GLSL = { "sqrt", "abs", "floor", "min", "max", "" };
+			const Dialect Cpp = { "std::sqrt", "std::fabs", "std::floor", "std::min", "std::max", "f" };
+
+			std::string Literal(float f, const Dialect& dialect) {
+				char buffer[32];
+				snprintf(buffer, sizeof(buffer), "%.9g", f);
+				std::string literal = buffer;
+				//Both languages need a decimal point for the literal to be a float
+				if (literal.find_first_of(".e") == std::string::npos)
+					literal += ".0";
+				literal += dialect.FloatSuffix;
+				if (f < 0.f)
+					literal = "(" + literal + ")";
+				return literal;
+			}
+
+			std::string Point(int index, char axis) {
+				return "p" + std::to_string(index) + axis;
+			}
+
+			std::string Distance(int index) {
+				return "d" + std::to_string(index);
+			}
+
+			void EmitInstruction(const Instruction& in, const Dialect& dialect, const std::string& indent, std::ostringstream& out) {
+				std::string x = Point(in.A, 'x'), y = Point(in.A, 'y'), z = Point(in.A, 'z');
+				std::string a = Distance(in.A), b = Distance(in.B), d = Distance(in.Out);
+				std::string k = Literal(in.Value, dialect);
+				std::string one = Literal(1.f, dialect), half = Literal(0.5f, dialect), zero = Literal(0.f, dialect);
+				std::string sqrt = dialect.Sqrt, abs = dialect.Abs, min = dialect.Min, max = dialect.Max;
+				auto vector = [&](int axis) { return Literal(in.Vector[axis], dialect); };
+				auto clamp01 = [&](const std::string& e) { return min + "(" + max + "(" + e + ", " + zero + "), " + one + ")"; };
+				std::string h = d + "h";
+
+				switch (in.Op) {
+				case OP_SPHERE:
+					out << indent << "float " << d << " = " << sqrt << "(" << x << " * " << x << " + " << y << " * " << y << " + " << z << " * " << z << ") - " << k << ";\n";
+					break;
+				case OP_BOX:
+					out << indent << "float " << d << "x = " << abs << "(" << x << ") - " << vector(0) << ", " << d << "y = " << abs << "(" << y << ") - " << vector(1) << ", " << d << "z = " << abs << "(" << z << ") - " << vector(2) << ";\n";
+					out << indent << "float " << d << "mx = " << max << "(" << d << "x, " << zero << "), " << d << "my = " << max << "(" << d << "y, " << zero << "), " << d << "mz = " << max << "(" << d << "z, " << zero << ");\n";
+					out << indent << "float " << d << " = " << sqrt << "(" << d << "mx * " << d << "mx + " << d << "my * " << d << "my + " << d << "mz * " << d << "mz) + " << min << "(" << max << "(" << d << "x, " << max << "(" << d << "y, " << d << "z)), " << zero << ");\n";
+					break;
+				case OP_PLANE:
+					out << indent << "float " << d << " = " << x << " * " << vector(0) << " + " << y << " * " << vector(1) << " + " << z << " * " << vector(2) << " + " << k << ";\n";
+					break;
+				case OP_TORUS:
+					out << indent << "float " << d << "x = " << sqrt << "(" << x << " * " << x << " + " << z << " * " << z << ") - " << vector(0) << ";\n";
+					out << indent << "float " << d << " = " << sqrt << "(" << d << "x * " << d << "x + " << y << " * " << y << ") - " << vector(1) << ";\n";
+					break;
+				case OP_CYLINDER:
+					out << indent << "float " << d << "x = " << sqrt << "(" << x << " * " << x << " + " << z << " * " << z << ") - " << vector(0) << ", " << d << "y = " << abs << "(" << y << ") - " << vector(1) << ";\n";
+					out << indent << "float " << d << "mx = " << max << "(" << d << "x, " << zero << "), " << d << "my = " << max << "(" << d << "y, " << zero << ");\n";
+					out << indent << "float " << d << " = " << min << "(" << max << "(" << d << "x, " << d << "y), " << zero << ") + " << sqrt << "(" << d << "mx * " << d << "mx + " << d << "my * " << d << "my);\n";
+					break;
+
+				case OP_MIN:
+					out << indent << "float " << d << " = " << min << "(" << a << ", " << b << ");\n";
+					break;
+				case OP_MAX:
+					out << indent << "float " << d << " = " << max << "(" << a << ", " << b << ");\n";
+					break;
+				case OP_SUBTRACT:
+					out << indent << "float " << d << " = " << max << "(" << a << ", -" << b << ");\n";
+					break;
+				case OP_SMOOTH_UNION:
+					out << indent << "float " << h << " = " << clamp01(half + " + " + half + " * (" + b + " - " + a + ") / " + k) << ";\n";
+					out << indent << "float " << d << " = " << b << " + (" << a << " - " << b << ") * " << h << " - " << k << " * " << h << " * (" << one << " - " << h << ");\n";
+					break;
+				case OP_SMOOTH_INTERSECTION:
+					out << indent << "float " << h << " = " << clamp01(half + " - " + half + " * (" + b + " - " + a + ") / " + k) << ";\n";
+					out << indent << "float " << d << " = " << b << " + (" << a << " - " << b << ") * " << h << " + " << k << " * " << h << " * (" << one << " - " << h << ");\n";
+					break;
+				case OP_SMOOTH_SUBTRACTION:
+					out << indent << "float " << h << " = " << clamp01(half + " - " + half + " * (" + a + " + " + b + ") / " + k) << ";\n";
+					out << indent << "float " << d << " = " << a << " + (-" << b << " - " << a << ") * " << h << " + " << k << " * " << h << " * (" << one << " - " << h << ");\n";
+					break;
+				case OP_MULTIPLY:
+					out << indent << "float " << d << " = " << a << " * " << k << ";\n";
+					break;
+
+				case OP_TRANSLATE:
+					out << indent << "float " << Point(in.Out, 'x') << " = " << x << " - " << vector(0) << ", " << Point(in.Out, 'y') << " = " << y << " - " << vector(1) << ", " << Point(in.Out, 'z') << " = " << z << " - " << vector(2) << ";\n";
+					break;
+				case OP_ROTATE: {
+					const char axes[3] = { 'x', 'y', 'z' };
+					for (int row = 0; row < 3; row++)
+						out << indent << "float " << Point(in.Out, axes[row]) << " = " << Literal(in.Matrix[0][row], dialect) << " * " << x << " + " << Literal(in.Matrix[1][row], dialect) << " * " << y << " + " << Literal(in.Matrix[2][row], dialect) << " * " << z << ";\n";
+					break;
+				}
+				case OP_SCALE:
+					out << indent << "float " << Point(in.Out, 'x') << " = " << x << " * " << k << ", " << Point(in.Out, 'y') << " = " << y << " * " << k << ", " << Point(in.Out, 'z') << " = " << z << " * " << k << ";\n";
+					break;
+				case OP_REPEAT: {
+					const char axes[3] = { 'x', 'y', 'z' };
+					for (int axis = 0; axis < 3; axis++) {
+						std::string from = Point(in.A, axes[axis]);
+						out << indent << "float " << Point(in.Out, axes[axis]) << " = " << from;
+						if (in.Vector[axis] > 0.f) {
+							std::string c = vector(axis);
+							out << " - " << c << " * " << dialect.Floor << "(" << from << " / " << c << " + " << half << ")";
+						}
+						out << ";\n";
+					}
+					break;
+				}
+				}
+			}
+
+			std::string Gradient(int index, char axis) {
+				return "d" + std::to_string(index) + "g" + axis;
+			}
+
+			//Emits the instruction like EmitInstruction does, followed by the gradient of its distance as d<N>gx, d<N>gy and d<N>gz.
+			//Point transforms have constant Jacobians, so they're folded into the primitives at compile time instead of being carried along
+			void EmitGradientInstruction(const Instruction& in, const std::vector<glm::mat3>& jacobians, const Dialect& dialect, const std::string& indent, std::ostringstream& out) {
+				EmitInstruction(in, dialect, indent, out);
+
+				std::string x = Point(in.A, 'x'), y = Point(in.A, 'y'), z = Point(in.A, 'z');
+				std::string a = Distance(in.A), b = Distance(in.B), d = Distance(in.Out);
+				std::string k = Literal(in.Value, dialect);
+				std::string one = Literal(1.f, dialect), zero = Literal(0.f, dialect);
+				std::string sqrt = dialect.Sqrt, max = dialect.Max;
+				auto vector = [&](int axis) { return Literal(in.Vector[axis], dialect); };
+				auto sign = [&](const std::string& e) { return "(" + e + " < " + zero + " ? " + Literal(-1.f, dialect) + " : " + one + ")"; };
+				//Lengths only reach zero where the gradient isn't defined anyway, this just keeps them from turning into NaNs
+				auto safe = [&](const std::string& e) { return max + "(" + e + ", " + Literal(1e-20f, dialect) + ")"; };
+				const char axes[3] = { 'x', 'y', 'z' };
+				std::string h = d + "h", n = d + "n";
+
+				//Takes the primitive's gradient in d<N>lx, d<N>ly and d<N>lz back through its point's Jacobian
+				auto emitLocal = [&]() {
+					const glm::mat3& jacobian = jacobians[in.A];
+					for (int axis = 0; axis < 3; axis++) {
+						out << indent << "float " << Gradient(in.Out, axes[axis]) << " = ";
+						if (jacobian == glm::mat3(1.f))
+							out << d << "l" << axes[axis];
+						else
+							out << Literal(jacobian[axis][0], dialect) << " * " << d << "lx + " << Literal(jacobian[axis][1], dialect) << " * " << d << "ly + " << Literal(jacobian[axis][2], dialect) << " * " << d << "lz";
+						out << ";\n";
+					}
+				};
+				auto emitPick = [&](const std::string& condition, const std::string& otherwise) {
+					for (int axis = 0; axis < 3; axis++)
+						out << indent << "float " << Gradient(in.Out, axes[axis]) << " = " << condition << " ? " << Gradient(in.A, axes[axis]) << " : " << otherwise << Gradient(in.B, axes[axis]) << ";\n";
+				};
+				//The smooth operators are all base + (other - base) * h + f * dh, h stops changing once it's clamped
+				auto emitSmooth = [&](bool baseIsA, const std::string& otherSign, const std::string& f, const std::string& slope, const std::string& hSign) {
+					out << indent << "float " << d << "f = " << f << ";\n";
+					out << indent << "float " << d << "s = " << h << " > " << zero << " && " << h << " < " << one << " ? " << slope << " : " << zero << ";\n";
+					for (int axis = 0; axis < 3; axis++) {
+						std::string ga = Gradient(in.A, axes[axis]), gb = Gradient(in.B, axes[axis]);
+						std::string base = baseIsA ? ga : gb, other = otherSign + (baseIsA ? gb : ga);
+						out << indent << "float " << Gradient(in.Out, axes[axis]) << " = " << base << " + (" << other << " - " << base << ") * " << h << " + " << d << "f * " << d << "s * (" << gb << " " << hSign << " " << ga << ");\n";
+					}
+				};
+
+				switch (in.Op) {
+				case OP_SPHERE:
+					out << indent << "float " << n << " = " << safe(sqrt + "(" + x + " * " + x + " + " + y + " * " + y + " + " + z + " * " + z + ")") << ";\n";
+					out << indent << "float " << d << "lx = " << x << " / " << n << ", " << d << "ly = " << y << " / " << n << ", " << d << "lz = " << z << " / " << n << ";\n";
+					emitLocal();
+					break;
+				case OP_BOX:
+					//Outside it points away from the nearest point of the box, inside it's the normal of the nearest face
+					out << indent << "float " << n << " = " << safe(sqrt + "(" + d + "mx * " + d + "mx + " + d + "my * " + d + "my + " + d + "mz * " + d + "mz)") << ";\n";
+					out << indent << "bool " << d << "o = " << d << "x > " << zero << " || " << d << "y > " << zero << " || " << d << "z > " << zero << ";\n";
+					out << indent << "float " << d << "lx = " << sign(x) << " * (" << d << "o ? " << d << "mx / " << n << " : " << d << "x >= " << d << "y && " << d << "x >= " << d << "z ? " << one << " : " << zero << ");\n";
+					out << indent << "float " << d << "ly = " << sign(y) << " * (" << d << "o ? " << d << "my / " << n << " : " << d << "y > " << d << "x && " << d << "y >= " << d << "z ? " << one << " : " << zero << ");\n";
+					out << indent << "float " << d << "lz = " << sign(z) << " * (" << d << "o ? " << d << "mz / " << n << " : " << d << "z > " << d << "x && " << d << "z > " << d << "y ? " << one << " : " << zero << ");\n";
+					emitLocal();
+					break;
+				case OP_PLANE:
+					out << indent << "float " << d << "lx = " << vector(0) << ", " << d << "ly = " << vector(1) << ", " << d << "lz = " << vector(2) << ";\n";
+					emitLocal();
+					break;
+				case OP_TORUS:
+					out << indent << "float " << d << "r = " << safe(sqrt + "(" + x + " * " + x + " + " + z + " * " + z + ")") << ";\n";
+					out << indent << "float " << n << " = " << safe(sqrt + "(" + d + "x * " + d + "x + " + y + " * " + y + ")") << ";\n";
+					out << indent << "float " << d << "lx = " << d << "x / " << n << " * " << x << " / " << d << "r, " << d << "ly = " << y << " / " << n << ", " << d << "lz = " << d << "x / " << n << " * " << z << " / " << d << "r;\n";
+					emitLocal();
+					break;
+				case OP_CYLINDER:
+					//Same as the box, in the plane of the radius and the height
+					out << indent << "float " << d << "r = " << safe(sqrt + "(" + x + " * " + x + " + " + z + " * " + z + ")") << ";\n";
+					out << indent << "float " << n << " = " << safe(sqrt + "(" + d + "mx * " + d + "mx + " + d + "my * " + d + "my)") << ";\n";
+					out << indent << "bool " << d << "o = " << d << "x > " << zero << " || " << d << "y > " << zero << ";\n";
+					out << indent << "float " << d << "ar = " << d << "o ? " << d << "mx / " << n << " : " << d << "x >= " << d << "y ? " << one << " : " << zero << ";\n";
+					out << indent << "float " << d << "ah = " << d << "o ? " << d << "my / " << n << " : " << d << "x >= " << d << "y ? " << zero << " : " << one << ";\n";
+					out << indent << "float " << d << "lx = " << d << "ar * " << x << " / " << d << "r, " << d << "ly = " << d << "ah * " << sign(y) << ", " << d << "lz = " << d << "ar * " << z << " / " << d << "r;\n";
+					emitLocal();
+					break;
+
+				case OP_MIN:
+					emitPick(a + " < " + b, "");
+					break;
+				case OP_MAX:
+					emitPick(a + " > " + b, "");
+					break;
+				case OP_SUBTRACT:
+					emitPick(a + " > -" + b, "-");
+					break;
+				case OP_SMOOTH_UNION:
+					emitSmooth(false, "", "(" + a + " - " + b + ") - " + k + " * (" + one + " - " + Literal(2.f, dialect) + " * " + h + ")", Literal(0.5f / in.Value, dialect), "-");
+					break;
+				case OP_SMOOTH_INTERSECTION:
+					emitSmooth(false, "", "(" + a + " - " + b + ") + " + k + " * (" + one + " - " + Literal(2.f, dialect) + " * " + h + ")", Literal(-0.5f / in.Value, dialect), "-");
+					break;
+				case OP_SMOOTH_SUBTRACTION:
+					emitSmooth(true, "-", "(-" + b + " - " + a + ") + " + k + " * (" + one + " - " + Literal(2.f, dialect) + " * " + h + ")", Literal(-0.5f / in.Value, dialect), "+");
+					break;
+				case OP_MULTIPLY:
+					for (int axis = 0; axis < 3; axis++)
+						out << indent << "float " << Gradient(in.Out, axes[axis]) << " = " << Gradient(in.A, axes[axis]) << " * " << k << ";\n";
+					break;
+
+				default:
+					break;
+				}
+			}
+
+			//The Jacobian of every point register with respect to the input point
+			std::vector<glm::mat3> PointJacobians(const Program& program) {
+				std::vector<glm::mat3> jacobians(program.PointRegisters(), glm::mat3(1.f));
+				const std::vector<Instruction>& instructions = program.Instructions();
+				for (size_t i = 0; i < instructions.size(); i++) {
+					const Instruction& in = instructions[i];
+					switch (in.Op) {
+					case OP_TRANSLATE:
+					case OP_REPEAT:
+						jacobians[in.Out] = jacobians[in.A];
+						break;
+					case OP_ROTATE:
+						jacobians[in.Out] = in.Matrix * jacobians[in.A];
+						break;
+					case OP_SCALE:
+						jacobians[in.Out] = jacobians[in.A] * in.Value;
+						break;
+					default:
+						break;
+					}
+				}
+				return jacobians;
+			}
+
+			void EmitBody(const Program& program, const Dialect& dialect, const std::string& indent, std::ostringstream& out) {
+				const std::vector<Instruction>& instructions = program.Instructions();
+				for (size_t i = 0; i < instructions.size(); i++)
+					EmitInstruction(instructions[i], dialect, indent, out);
+			}
+
+			void EmitGradientBody(const Program& program, const Dialect& dialect, const std::string& indent, std::ostringstream& out) {
+				std::vector<glm::mat3> jacobians = PointJacobians(program);
+				const std::vector<Instruction>& instructions = program.Instructions();
+				for (size_t i = 0; i < instructions.size(); i++)
+					EmitGradientInstruction(instructions[i], jacobians, dialect, indent, out);
+			}
+		}
+
+		std::string EmitGLSL(const Program& program, const std::string& name) {
+			std::ostringstream out;
+			out << "float " << name << "(in vec3 p) {\n";
+			out << "\tfloat p0x = p.x, p0y = p.y, p0z = p.z;\n";
+			EmitBody(program, GLSL, "\t", out);
+			out << "\treturn " << Distance(program.Result()) << ";\n";
+			out << "}\n";
+			return out.str();
+		}
+
+		std::string EmitCpp(const Program& program, const std::string& name) {
+			std::ostringstream out;
+			out << "void " << name << "(const float* x, const float* y, const float* z, float* out, int count) {\n";
+			out << "\tfor (int i = 0; i < count; i++) {\n";
+			out << "\t\tfloat p0x = x[i], p0y = y[i], p0z = z[i];\n";
+			EmitBody(program, Cpp, "\t\t", out);
+			out << "\t\tout[i] = " << Distance(program.Result()) << ";\n";
+			out << "\t}\n";
+			out << "}\n";
+			return out.str();
+		}
+
+		std::string EmitGLSLGradient(const Program& program, const std::string& name) {
+			std::ostringstream out;
+			std::string result = Distance(program.Result());
+			out << "vec4 " << name << "(in vec3 p) {\n";
+			out << "\tfloat p0x = p.x, p0y = p.y, p0z = p.z;\n";
+			EmitGradientBody(program, GLSL, "\t", out);
+			out << "\treturn vec4(" << result << "gx, " << result << "gy, " << result << "gz, " << result << ");\n";
+			out << "}\n";
+			return out.str();
+		}
+
+		std::string EmitCppGradient(const Program& program, const std::string& name) {
+			std::ostringstream out;
+			std::string result = Distance(program.Result());
+			out << "float " << name << "(float x, float y, float z, float* gradient) {\n";
+			out << "\tfloat p0x = x, p0y = y, p0z = z;\n";
+			EmitGradientBody(program, Cpp, "\t", out);
+			out << "\tgradient[0] = " << result << "gx;\n";
+			out << "\tgradient[1] = " << result << "gy;\n";
+			out << "\tgradient[2] = " << result << "gz;\n";
+			out << "\treturn " << result << ";\n";
+			out << "}\n";
+			return out.str();
+		}
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+
+#include "Program.h"
+
+/*
+	Turns a Program into source code, so the same scene can be compiled into the shader and into the host.
+*/
+
+namespace marcher {
+	namespace sdf {
+		//A "float name(in vec3 p)" GLSL function, name it SceneSDF to use it in place of a hand written scene
+		std::string EmitGLSL(const Program& program, const std::string& name = "SceneSDF");
+		//A "void name(const float* x, const float* y, const float* z, float* out, int count)" C++ function with the same signature as Scene::Distance.
+		//The loop body is branch free so the compiler can vectorize it, it needs <algorithm> and <cmath>
+		std::string EmitCpp(const Program& program, const std::string& name);
+		//A "vec4 name(in vec3 p)" GLSL function returning the gradient in xyz and the distance in w, the shader uses SceneGradient for its normals
+		std::string EmitGLSLGradient(const Program& program, const std::string& name = "SceneGradient");
+		//A "float name(float x, float y, float z, float* gradient)" C++ function returning the distance and writing the gradient
+		std::string EmitCppGradient(const Program& program, const std::string& name);
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "../Maths.h"
+
+/*
+	Dual numbers for forward mode differentiation, every value carries its gradient with respect to the input point along with it.
+	Where an operation isn't differentiable (the kink of abs, min or max) the gradient of one side is picked.
+*/
+
+namespace marcher {
+	namespace sdf {
+		struct Dual {
+			float Value;
+			glm::vec3 Gradient;
+
+			Dual() : Value(0.f), Gradient(0.f) {}
+			Dual(float f) : Value(f), Gradient(0.f) {}
+			Dual(float value, const glm::vec3& gradient) : Value(value), Gradient(gradient) {}
+		};
+
+		inline Dual operator+(const Dual& a, const Dual& b) { return Dual(a.Value + b.Value, a.Gradient + b.Gradient); }
+		inline Dual operator-(const Dual& a, const Dual& b) { return Dual(a.Value - b.Value, a.Gradient - b.Gradient); }
+		inline Dual operator-(const Dual& a) { return Dual(-a.Value, -a.Gradient); }
+		inline Dual operator*(const Dual& a, const Dual& b) { return Dual(a.Value * b.Value, a.Gradient * b.Value + b.Gradient * a.Value); }
+		inline Dual operator*(const Dual& a, float f) { return Dual(a.Value * f, a.Gradient * f); }
+		inline Dual operator/(const Dual& a, float f) { return Dual(a.Value / f, a.Gradient / f); }
+
+		inline Dual Min(const Dual& a, const Dual& b) { return a.Value < b.Value ? a : b; }
+		inline Dual Max(const Dual& a, const Dual& b) { return a.Value > b.Value ? a : b; }
+		inline Dual Abs(const Dual& a) { return a.Value < 0.f ? -a : a; }
+		inline Dual Clamp01(const Dual& a) { return Min(Max(a, 0.f), 1.f); }
+		//Piecewise constant, so only the value changes
+		inline Dual Floor(const Dual& a) { return Dual(std::floor(a.Value), glm::vec3(0.f)); }
+
+		inline Dual Sqrt(const Dual& a) {
+			float root = std::sqrt(std::max(a.Value, 0.f));
+			//The slope is infinite at 0, where it only ever comes up as the length of a zero vector
+			return Dual(root, root > 0.f ? a.Gradient * (0.5f / root) : glm::vec3(0.f));
+		}
+	}
+}
@@ -0,0 +1,82 @@
+#include "Expression.h"
+
+namespace marcher {
+	namespace sdf {
+		namespace {
+			Expr MakeNode(NodeType type, std::vector<Expr> children, glm::vec3 vector = glm::vec3(0), float value = 0.f, glm::mat3 matrix = glm::mat3(1)) {
+				std::shared_ptr<Node> node = std::make_shared<Node>();
+				node->Type = type;
+				node->Children = children;
+				node->Vector = vector;
+				node->Value = value;
+				node->Matrix = matrix;
+				return node;
+			}
+		}
+
+		Expr Sphere(float radius) {
+			return MakeNode(SPHERE, {}, glm::vec3(0), radius);
+		}
+
+		Expr Box(glm::vec3 halfExtents) {
+			return MakeNode(BOX, {}, halfExtents);
+		}
+
+		Expr Plane(glm::vec3 normal, float offset) {
+			return MakeNode(PLANE, {}, normal, offset);
+		}
+
+		Expr Torus(float majorRadius, float minorRadius) {
+			return MakeNode(TORUS, {}, glm::vec3(majorRadius, minorRadius, 0));
+		}
+
+		Expr Cylinder(float radius, float halfHeight) {
+			return MakeNode(CYLINDER, {}, glm::vec3(radius, halfHeight, 0));
+		}
+
+		Expr Union(Expr a, Expr b) {
+			return MakeNode(UNION, { a, b });
+		}
+
+		Expr Intersection(Expr a, Expr b) {
+			return MakeNode(INTERSECTION, { a, b });
+		}
+
+		Expr Subtraction(Expr a, Expr b) {
+			return MakeNode(SUBTRACTION, { a, b });
+		}
+
+		Expr SmoothUnion(Expr a, Expr b, float k) {
+			return MakeNode(SMOOTH_UNION, { a, b }, glm::vec3(0), k);
+		}
+
+		Expr SmoothIntersection(Expr a, Expr b, float k) {
+			return MakeNode(SMOOTH_INTERSECTION, { a, b }, glm::vec3(0), k);
+		}
+
+		Expr SmoothSubtraction(Expr a, Expr b, float k) {
+			return MakeNode(SMOOTH_SUBTRACTION, { a, b }, glm::vec3(0), k);
+		}
+
+		Expr Translate(Expr a, glm::vec3 offset) {
+			return MakeNode(TRANSLATE, { a }, offset);
+		}
+
+		Expr Rotate(Expr a, glm::mat3 rotation) {
+			//Points get taken back into local space, which for a rotation is the transpose
+			return MakeNode(ROTATE, { a }, glm::vec3(0), 0.f, glm::transpose(rotation));
+		}
+
+		Expr Rotate(Expr a, float angle, glm::vec3 axis) {
+			return Rotate(a, glm::mat3(glm::rotate(angle, glm::normalize(axis))));
+		}
+
+		Expr Scale(Expr a, float factor) {
+			return MakeNode(SCALE, { a }, glm::vec3(0), factor);
+		}
+
+		Expr Repeat(Expr a, glm::vec3 period) {
+			return MakeNode(REPEAT, { a }, period);
+		}
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "../Maths.h"
+
+/*
+	A scene described as an expression graph instead of GLSL text, so the host can inspect and evaluate it.
+	Every node is a distance field. Domain nodes (translate, rotate, scale, repeat) change the point their single child is evaluated at.
+	Expressions are immutable, build them with the functions below and share subexpressions freely.
+*/
+
+namespace marcher {
+	namespace sdf {
+		enum NodeType {
+			//Primitives
+			SPHERE,
+			BOX,
+			PLANE,
+			TORUS,
+			CYLINDER,
+			//Combinations of two children
+			UNION,
+			INTERSECTION,
+			SUBTRACTION,
+			SMOOTH_UNION,
+			SMOOTH_INTERSECTION,
+			SMOOTH_SUBTRACTION,
+			//Domain operations on one child
+			TRANSLATE,
+			ROTATE,
+			SCALE,
+			REPEAT
+		};
+
+		struct Node {
+			NodeType Type;
+			std::vector<std::shared_ptr<const Node>> Children;
+			//What these hold depends on the type, see the builder functions
+			glm::vec3 Vector;
+			float Value;
+			glm::mat3 Matrix;
+		};
+
+		typedef std::shared_ptr<const Node> Expr;
+
+		Expr Sphere(float radius);
+		Expr Box(glm::vec3 halfExtents);
+		//Distance to the plane dot(p, normal) + offset = 0, normal has to be normalized
+		Expr Plane(glm::vec3 normal, float offset = 0.f);
+		//Lies in the xz plane
+		Expr Torus(float majorRadius, float minorRadius);
+		//Capped, along the y axis
+		Expr Cylinder(float radius, float halfHeight);
+
+		Expr Union(Expr a, Expr b);
+		Expr Intersection(Expr a, Expr b);
+		//a with b cut out of it
+		Expr Subtraction(Expr a, Expr b);
+		//k is the size of the blend region
+		Expr SmoothUnion(Expr a, Expr b, float k);
+		Expr SmoothIntersection(Expr a, Expr b, float k);
+		Expr SmoothSubtraction(Expr a, Expr b, float k);
+
+		Expr Translate(Expr a, glm::vec3 offset);
+		//rotation takes the shape's local space to world space
+		Expr Rotate(Expr a, glm::mat3 rotation);
+		Expr Rotate(Expr a, float angle, glm::vec3 axis);
+		Expr Scale(Expr a, float factor);
+		//Repeats a every period units, axes with a period of 0 aren't repeated
+		Expr Repeat(Expr a, glm::vec3 period);
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "../CPU/Scene.h"
+#include "Program.h"
+
+namespace marcher {
+	namespace sdf {
+		//Lets the CPU renderer march an expression, the packet marchers get the batched evaluator
+		class ExpressionScene : public cpu::Scene {
+		public:
+			ExpressionScene(const Expr& scene) : m_program(scene) {}
+
+			float Distance(const glm::vec3& p) const override { return m_program.Evaluate(p); }
+			void Distance(const float* x, const float* y, const float* z, float* out, int count) const override { m_program.Evaluate(x, y, z, out, count); }
+			bool Gradient(const glm::vec3& p, glm::vec3& gradient) const override { m_program.Evaluate(p, gradient); return true; }
+
+			const Program& GetProgram() const { return m_program; }
+
+		private:
+			Program m_program;
+		};
+	}
+}
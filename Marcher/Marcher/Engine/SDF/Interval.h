@@ -0,0 +1,48 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+/*
+	Interval arithmetic, every operation returns a range guaranteed to hold the result for any inputs within the operands' ranges.
+*/
+
+namespace marcher {
+	namespace sdf {
+		struct Interval {
+			float Min, Max;
+
+			Interval() : Min(0.f), Max(0.f) {}
+			Interval(float f) : Min(f), Max(f) {}
+			Interval(float min, float max) : Min(min), Max(max) {}
+
+			bool Contains(float f) const { return Min <= f && f <= Max; }
+			float Width() const { return Max - Min; }
+		};
+
+		inline Interval operator+(Interval a, Interval b) { return Interval(a.Min + b.Min, a.Max + b.Max); }
+		inline Interval operator-(Interval a, Interval b) { return Interval(a.Min - b.Max, a.Max - b.Min); }
+		inline Interval operator-(Interval a) { return Interval(-a.Max, -a.Min); }
+		inline Interval operator*(Interval a, float f) { return f >= 0.f ? Interval(a.Min * f, a.Max * f) : Interval(a.Max * f, a.Min * f); }
+
+		inline Interval Min(Interval a, Interval b) { return Interval(std::min(a.Min, b.Min), std::min(a.Max, b.Max)); }
+		inline Interval Max(Interval a, Interval b) { return Interval(std::max(a.Min, b.Min), std::max(a.Max, b.Max)); }
+
+		inline Interval Abs(Interval a) {
+			if (a.Min >= 0.f)
+				return a;
+			if (a.Max <= 0.f)
+				return -a;
+			return Interval(0.f, std::max(-a.Min, a.Max));
+		}
+
+		inline Interval Square(Interval a) {
+			Interval b = Abs(a);
+			return Interval(b.Min * b.Min, b.Max * b.Max);
+		}
+
+		inline Interval Sqrt(Interval a) {
+			return Interval(std::sqrt(std::max(a.Min, 0.f)), std::sqrt(std::max(a.Max, 0.f)));
+		}
+	}
+}
@@ -0,0 +1,115 @@
+#include "Octree.h"
+
+namespace marcher {
+	namespace sdf {
+		namespace {
+			//Anything at most this many samples wide is sampled exactly instead of split further
+			const int LeafSamples = 4;
+
+			bool MightHoldSurface(const Interval& distance, float band) {
+				return distance.Min <= band && distance.Max >= -band;
+			}
+
+			void FindCells(const Program& program, const glm::vec3& min, const glm::vec3& max, int depth, std::vector<OctreeCell>& cells, OctreeStats& stats) {
+				Interval distance = program.Bound(min, max);
+				stats.Bounds++;
+				if (!MightHoldSurface(distance, 0.f))
+					return;
+
+				if (depth == 0) {
+					OctreeCell cell = { min, max, distance };
+					cells.push_back(cell);
+					return;
+				}
+
+				glm::vec3 center = (min + max) * 0.5f;
+				for (int child = 0; child < 8; child++) {
+					glm::bvec3 upper((child & 1) != 0, (child & 2) != 0, (child & 4) != 0);
+					FindCells(program, glm::mix(min, center, upper), glm::mix(center, max, upper), depth - 1, cells, stats);
+				}
+			}
+
+			struct Grid {
+				glm::vec3 Min, VoxelSize;
+				glm::ivec3 Resolution;
+				float Band;
+				std::vector<float>* Distances;
+
+				glm::vec3 Center(const glm::ivec3& index) const { return Min + (glm::vec3(index) + 0.5f) * VoxelSize; }
+				float& At(int x, int y, int z) const { return (*Distances)[((size_t)z * Resolution.y + y) * Resolution.x + x]; }
+			};
+
+			//Fills the samples with indices from begin up to but not including end
+			void BakeBlock(const Program& program, const Grid& grid, const glm::ivec3& begin, const glm::ivec3& end, OctreeStats& stats) {
+				Interval distance = program.Bound(grid.Center(begin), grid.Center(end - 1));
+				stats.Bounds++;
+
+				if (!MightHoldSurface(distance, grid.Band)) {
+					float fill = distance.Min > 0.f ? distance.Min : distance.Max;
+					for (int z = begin.z; z < end.z; z++)
+						for (int y = begin.y; y < end.y; y++)
+							for (int x = begin.x; x < end.x; x++)
+								grid.At(x, y, z) = fill;
+					return;
+				}
+
+				glm::ivec3 size = end - begin;
+				if (glm::max(size.x, glm::max(size.y, size.z)) <= LeafSamples) {
+					//Rows are contiguous, so they go through the batched evaluator
+					float xs[LeafSamples], ys[LeafSamples], zs[LeafSamples];
+					for (int z = begin.z; z < end.z; z++) {
+						for (int y = begin.y; y < end.y; y++) {
+							for (int x = begin.x; x < end.x; x++) {
+								glm::vec3 p = grid.Center(glm::ivec3(x, y, z));
+								xs[x - begin.x] = p.x;
+								ys[x - begin.x] = p.y;
+								zs[x - begin.x] = p.z;
+							}
+							program.Evaluate(xs, ys, zs, &grid.At(begin.x, y, z), size.x);
+							stats.Samples += size.x;
+						}
+					}
+					return;
+				}
+
+				//Axes that are already thin enough aren't split
+				glm::ivec3 middle = begin + size / 2;
+				for (int child = 0; child < 8; child++) {
+					glm::ivec3 childBegin = begin, childEnd = end;
+					bool skip = false;
+					for (int axis = 0; axis < 3; axis++) {
+						bool upper = (child >> axis & 1) != 0;
+						if (size[axis] <= LeafSamples) {
+							skip |= upper;
+							continue;
+						}
+						if (upper)
+							childBegin[axis] = middle[axis];
+						else
+							childEnd[axis] = middle[axis];
+					}
+					if (!skip)
+						BakeBlock(program, grid, childBegin, childEnd, stats);
+				}
+			}
+		}
+
+		void FindSurfaceCells(const Program& program, const glm::vec3& min, const glm::vec3& max, int maxDepth, std::vector<OctreeCell>& cells, OctreeStats* stats) {
+			OctreeStats local;
+			FindCells(program, min, max, maxDepth, cells, local);
+			if (stats)
+				*stats = local;
+		}
+
+		void BakeVolume(const Program& program, const glm::vec3& min, const glm::vec3& max, const glm::ivec3& resolution, float band, std::vector<float>& distances, OctreeStats* stats) {
+			distances.resize((size_t)resolution.x * resolution.y * resolution.z);
+			Grid grid = { min, (max - min) / glm::vec3(resolution), resolution, band, &distances };
+
+			OctreeStats local;
+			if (resolution.x > 0 && resolution.y > 0 && resolution.z > 0)
+				BakeBlock(program, grid, glm::ivec3(0), resolution, local);
+			if (stats)
+				*stats = local;
+		}
+	}
+}
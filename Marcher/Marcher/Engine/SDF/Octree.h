@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+
+#include "Program.h"
+
+/*
+	Octree subdivision driven by Program::Bound(). Cells whose distance bounds can't reach the surface are never split or sampled,
+	so the work grows with the area of the surface instead of the volume of the box.
+*/
+
+namespace marcher {
+	namespace sdf {
+		struct OctreeCell {
+			glm::vec3 Min, Max;
+			Interval Distance;
+		};
+
+		struct OctreeStats {
+			//Program::Bound() calls and points evaluated exactly
+			unsigned long long Bounds = 0, Samples = 0;
+		};
+
+		//Finds the cells of a maxDepth deep octree over the box that might hold part of the surface, ready for meshing
+		void FindSurfaceCells(const Program& program, const glm::vec3& min, const glm::vec3& max, int maxDepth, std::vector<OctreeCell>& cells, OctreeStats* stats = nullptr);
+
+		//Samples the distance at the centers of a resolution sized grid over the box, x first then y then z like .vol files.
+		//Samples within band of the surface are exact, the rest get the closest bound to the surface that's known for their cell, which is still safe to march through
+		void BakeVolume(const Program& program, const glm::vec3& min, const glm::vec3& max, const glm::ivec3& resolution, float band, std::vector<float>& distances, OctreeStats* stats = nullptr);
+	}
+}
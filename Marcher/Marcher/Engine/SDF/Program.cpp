@@ -0,0 +1,495 @@
+#include "Program.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace marcher {
+	namespace sdf {
+		Program::Program(const Expr& scene)
+			: m_pointRegisters(1), m_distanceRegisters(0), m_result(0) {
+			m_result = CompileDistance(*scene, 0);
+		}
+
+		int Program::CompileDistance(const Node& node, int point) {
+			Instruction instruction;
+			instruction.A = point;
+			instruction.B = 0;
+			instruction.Vector = node.Vector;
+			instruction.Value = node.Value;
+			instruction.Matrix = node.Matrix;
+
+			switch (node.Type) {
+			case SPHERE: instruction.Op = OP_SPHERE; break;
+			case BOX: instruction.Op = OP_BOX; break;
+			case PLANE: instruction.Op = OP_PLANE; break;
+			case TORUS: instruction.Op = OP_TORUS; break;
+			case CYLINDER: instruction.Op = OP_CYLINDER; break;
+
+			case UNION:
+			case INTERSECTION:
+			case SUBTRACTION:
+			case SMOOTH_UNION:
+			case SMOOTH_INTERSECTION:
+			case SMOOTH_SUBTRACTION:
+				instruction.A = CompileDistance(*node.Children[0], point);
+				instruction.B = CompileDistance(*node.Children[1], point);
+				switch (node.Type) {
+				case UNION: instruction.Op = OP_MIN; break;
+				case INTERSECTION: instruction.Op = OP_MAX; break;
+				case SUBTRACTION: instruction.Op = OP_SUBTRACT; break;
+				case SMOOTH_UNION: instruction.Op = OP_SMOOTH_UNION; break;
+				case SMOOTH_INTERSECTION: instruction.Op = OP_SMOOTH_INTERSECTION; break;
+				default: instruction.Op = OP_SMOOTH_SUBTRACTION; break;
+				}
+				break;
+
+			case SCALE: {
+				//The child's distance is in its own units, so it gets scaled back up afterwards
+				int child = CompileDistance(*node.Children[0], CompilePoint(node, point));
+				instruction.Op = OP_MULTIPLY;
+				instruction.A = child;
+				break;
+			}
+			default:
+				return CompileDistance(*node.Children[0], CompilePoint(node, point));
+			}
+
+			instruction.Out = m_distanceRegisters++;
+			m_instructions.push_back(instruction);
+			return instruction.Out;
+		}
+
+		int Program::CompilePoint(const Node& node, int point) {
+			Instruction instruction;
+			instruction.A = point;
+			instruction.B = 0;
+			instruction.Vector = node.Vector;
+			instruction.Value = node.Value;
+			instruction.Matrix = node.Matrix;
+
+			switch (node.Type) {
+			case TRANSLATE: instruction.Op = OP_TRANSLATE; break;
+			case ROTATE: instruction.Op = OP_ROTATE; break;
+			case SCALE:
+				instruction.Op = OP_SCALE;
+				instruction.Value = 1.f / node.Value;
+				break;
+			default: instruction.Op = OP_REPEAT; break;
+			}
+
+			instruction.Out = m_pointRegisters++;
+			m_instructions.push_back(instruction);
+			return instruction.Out;
+		}
+
+		float Program::Evaluate(const glm::vec3& p) const {
+			float out;
+			Evaluate(&p.x, &p.y, &p.z, &out, 1);
+			return out;
+		}
+
+		void Program::Evaluate(const float* x, const float* y, const float* z, float* out, int count) const {
+			//Every point register holds x, y and z for a whole batch, distance registers follow them
+			thread_local std::vector<float> registers;
+			size_t size = (size_t)(m_pointRegisters * 3 + m_distanceRegisters) * BatchSize;
+			if (registers.size() < size)
+				registers.resize(size);
+
+			for (int i = 0; i < count; i += BatchSize)
+				EvaluateBatch(x + i, y + i, z + i, out + i, std::min(count - i, (int)BatchSize), registers.data());
+		}
+
+		namespace {
+			inline float Clamp01(float f) {
+				return std::min(std::max(f, 0.f), 1.f);
+			}
+		}
+
+		void Program::EvaluateBatch(const float* x, const float* y, const float* z, float* out, int count, float* registers) const {
+			const int n = BatchSize;
+			float* distances = registers + m_pointRegisters * 3 * n;
+			std::copy(x, x + count, registers);
+			std::copy(y, y + count, registers + n);
+			std::copy(z, z + count, registers + 2 * n);
+
+			for (size_t index = 0; index < m_instructions.size(); index++) {
+				const Instruction& in = m_instructions[index];
+				const glm::vec3 v = in.Vector;
+				const float k = in.Value;
+
+				//A and Out are point or distance registers depending on the op, so each kind only works out the registers it uses
+				if (in.Op < OP_MIN) {
+					const float* px = registers + in.A * 3 * n;
+					const float* py = px + n;
+					const float* pz = py + n;
+					float* d = distances + in.Out * n;
+					switch (in.Op) {
+					case OP_SPHERE:
+						for (int i = 0; i < count; i++)
+							d[i] = std::sqrt(px[i] * px[i] + py[i] * py[i] + pz[i] * pz[i]) - k;
+						break;
+					case OP_BOX:
+						for (int i = 0; i < count; i++) {
+							float qx = std::fabs(px[i]) - v.x, qy = std::fabs(py[i]) - v.y, qz = std::fabs(pz[i]) - v.z;
+							float mx = std::max(qx, 0.f), my = std::max(qy, 0.f), mz = std::max(qz, 0.f);
+							d[i] = std::sqrt(mx * mx + my * my + mz * mz) + std::min(std::max(qx, std::max(qy, qz)), 0.f);
+						}
+						break;
+					case OP_PLANE:
+						for (int i = 0; i < count; i++)
+							d[i] = px[i] * v.x + py[i] * v.y + pz[i] * v.z + k;
+						break;
+					case OP_TORUS:
+						for (int i = 0; i < count; i++) {
+							float qx = std::sqrt(px[i] * px[i] + pz[i] * pz[i]) - v.x;
+							d[i] = std::sqrt(qx * qx + py[i] * py[i]) - v.y;
+						}
+						break;
+					case OP_CYLINDER:
+						for (int i = 0; i < count; i++) {
+							float qx = std::sqrt(px[i] * px[i] + pz[i] * pz[i]) - v.x, qy = std::fabs(py[i]) - v.y;
+							float mx = std::max(qx, 0.f), my = std::max(qy, 0.f);
+							d[i] = std::min(std::max(qx, qy), 0.f) + std::sqrt(mx * mx + my * my);
+						}
+						break;
+					default:
+						break;
+					}
+				}
+				else if (in.Op < OP_TRANSLATE) {
+					const float* a = distances + in.A * n;
+					const float* b = distances + in.B * n;
+					float* d = distances + in.Out * n;
+					switch (in.Op) {
+					case OP_MIN:
+						for (int i = 0; i < count; i++)
+							d[i] = std::min(a[i], b[i]);
+						break;
+					case OP_MAX:
+						for (int i = 0; i < count; i++)
+							d[i] = std::max(a[i], b[i]);
+						break;
+					case OP_SUBTRACT:
+						for (int i = 0; i < count; i++)
+							d[i] = std::max(a[i], -b[i]);
+						break;
+					case OP_SMOOTH_UNION:
+						for (int i = 0; i < count; i++) {
+							float h = Clamp01(0.5f + 0.5f * (b[i] - a[i]) / k);
+							d[i] = b[i] + (a[i] - b[i]) * h - k * h * (1.f - h);
+						}
+						break;
+					case OP_SMOOTH_INTERSECTION:
+						for (int i = 0; i < count; i++) {
+							float h = Clamp01(0.5f - 0.5f * (b[i] - a[i]) / k);
+							d[i] = b[i] + (a[i] - b[i]) * h + k * h * (1.f - h);
+						}
+						break;
+					case OP_SMOOTH_SUBTRACTION:
+						for (int i = 0; i < count; i++) {
+							float h = Clamp01(0.5f - 0.5f * (a[i] + b[i]) / k);
+							d[i] = a[i] + (-b[i] - a[i]) * h + k * h * (1.f - h);
+						}
+						break;
+					case OP_MULTIPLY:
+						for (int i = 0; i < count; i++)
+							d[i] = a[i] * k;
+						break;
+					default:
+						break;
+					}
+				}
+				else {
+					const float* px = registers + in.A * 3 * n;
+					const float* py = px + n;
+					const float* pz = py + n;
+					float* ox = registers + in.Out * 3 * n;
+					float* oy = ox + n;
+					float* oz = oy + n;
+					switch (in.Op) {
+					case OP_TRANSLATE:
+						for (int i = 0; i < count; i++) {
+							ox[i] = px[i] - v.x;
+							oy[i] = py[i] - v.y;
+							oz[i] = pz[i] - v.z;
+						}
+						break;
+					case OP_ROTATE: {
+						const glm::mat3& m = in.Matrix;
+						for (int i = 0; i < count; i++) {
+							ox[i] = m[0][0] * px[i] + m[1][0] * py[i] + m[2][0] * pz[i];
+							oy[i] = m[0][1] * px[i] + m[1][1] * py[i] + m[2][1] * pz[i];
+							oz[i] = m[0][2] * px[i] + m[1][2] * py[i] + m[2][2] * pz[i];
+						}
+						break;
+					}
+					case OP_SCALE:
+						for (int i = 0; i < count; i++) {
+							ox[i] = px[i] * k;
+							oy[i] = py[i] * k;
+							oz[i] = pz[i] * k;
+						}
+						break;
+					case OP_REPEAT: {
+						const float* from[3] = { px, py, pz };
+						float* to[3] = { ox, oy, oz };
+						for (int axis = 0; axis < 3; axis++) {
+							float c = v[axis];
+							if (c > 0.f) {
+								for (int i = 0; i < count; i++)
+									to[axis][i] = from[axis][i] - c * std::floor(from[axis][i] / c + 0.5f);
+							}
+							else
+								std::copy(from[axis], from[axis] + count, to[axis]);
+						}
+						break;
+					}
+					default:
+						break;
+					}
+				}
+			}
+
+			std::copy(distances + m_result * n, distances + m_result * n + count, out);
+		}
+
+		float Program::Evaluate(const glm::vec3& p, glm::vec3& gradient) const {
+			//Same register layout as the batched evaluator, one dual number per lane
+			thread_local std::vector<Dual> registers;
+			registers.resize((size_t)m_pointRegisters * 3 + m_distanceRegisters);
+			Dual* points = registers.data();
+			Dual* distances = points + m_pointRegisters * 3;
+			for (int axis = 0; axis < 3; axis++) {
+				glm::vec3 seed(0.f);
+				seed[axis] = 1.f;
+				points[axis] = Dual(p[axis], seed);
+			}
+
+			for (size_t index = 0; index < m_instructions.size(); index++) {
+				const Instruction& in = m_instructions[index];
+				const glm::vec3 v = in.Vector;
+				const float k = in.Value;
+
+				//Split by kind of op like the batched evaluator
+				if (in.Op < OP_MIN) {
+					const Dual* q = points + in.A * 3;
+					Dual& d = distances[in.Out];
+					switch (in.Op) {
+					case OP_SPHERE:
+						d = Sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2]) - k;
+						break;
+					case OP_BOX: {
+						Dual e[3], m[3];
+						for (int axis = 0; axis < 3; axis++) {
+							e[axis] = Abs(q[axis]) - v[axis];
+							m[axis] = Max(e[axis], 0.f);
+						}
+						d = Sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]) + Min(Max(e[0], Max(e[1], e[2])), 0.f);
+						break;
+					}
+					case OP_PLANE:
+						d = q[0] * v.x + q[1] * v.y + q[2] * v.z + k;
+						break;
+					case OP_TORUS: {
+						Dual qx = Sqrt(q[0] * q[0] + q[2] * q[2]) - v.x;
+						d = Sqrt(qx * qx + q[1] * q[1]) - v.y;
+						break;
+					}
+					case OP_CYLINDER: {
+						Dual qx = Sqrt(q[0] * q[0] + q[2] * q[2]) - v.x, qy = Abs(q[1]) - v.y;
+						Dual mx = Max(qx, 0.f), my = Max(qy, 0.f);
+						d = Min(Max(qx, qy), 0.f) + Sqrt(mx * mx + my * my);
+						break;
+					}
+					default:
+						break;
+					}
+				}
+				else if (in.Op < OP_TRANSLATE) {
+					Dual a = distances[in.A], b = distances[in.B];
+					Dual& d = distances[in.Out];
+					switch (in.Op) {
+					case OP_MIN:
+						d = Min(a, b);
+						break;
+					case OP_MAX:
+						d = Max(a, b);
+						break;
+					case OP_SUBTRACT:
+						d = Max(a, -b);
+						break;
+					case OP_SMOOTH_UNION: {
+						Dual h = Clamp01((b - a) * (0.5f / k) + 0.5f);
+						d = b + (a - b) * h - h * (Dual(1.f) - h) * k;
+						break;
+					}
+					case OP_SMOOTH_INTERSECTION: {
+						Dual h = Clamp01(Dual(0.5f) - (b - a) * (0.5f / k));
+						d = b + (a - b) * h + h * (Dual(1.f) - h) * k;
+						break;
+					}
+					case OP_SMOOTH_SUBTRACTION: {
+						Dual h = Clamp01(Dual(0.5f) - (a + b) * (0.5f / k));
+						d = a + (-b - a) * h + h * (Dual(1.f) - h) * k;
+						break;
+					}
+					case OP_MULTIPLY:
+						d = a * k;
+						break;
+					default:
+						break;
+					}
+				}
+				else {
+					const Dual* q = points + in.A * 3;
+					Dual* o = points + in.Out * 3;
+					switch (in.Op) {
+					case OP_TRANSLATE:
+						for (int axis = 0; axis < 3; axis++)
+							o[axis] = q[axis] - v[axis];
+						break;
+					case OP_ROTATE:
+						for (int row = 0; row < 3; row++)
+							o[row] = q[0] * in.Matrix[0][row] + q[1] * in.Matrix[1][row] + q[2] * in.Matrix[2][row];
+						break;
+					case OP_SCALE:
+						for (int axis = 0; axis < 3; axis++)
+							o[axis] = q[axis] * k;
+						break;
+					case OP_REPEAT:
+						for (int axis = 0; axis < 3; axis++) {
+							float c = v[axis];
+							o[axis] = c > 0.f ? q[axis] - Floor(q[axis] / c + 0.5f) * c : q[axis];
+						}
+						break;
+					default:
+						break;
+					}
+				}
+			}
+
+			gradient = distances[m_result].Gradient;
+			return distances[m_result].Value;
+		}
+
+		Interval Program::Bound(const glm::vec3& min, const glm::vec3& max) const {
+			//Same register layout as the batched evaluator, one interval per lane
+			thread_local std::vector<Interval> registers;
+			registers.resize((size_t)m_pointRegisters * 3 + m_distanceRegisters);
+			Interval* points = registers.data();
+			Interval* distances = points + m_pointRegisters * 3;
+			for (int axis = 0; axis < 3; axis++)
+				points[axis] = Interval(min[axis], max[axis]);
+
+			for (size_t index = 0; index < m_instructions.size(); index++) {
+				const Instruction& in = m_instructions[index];
+				const glm::vec3 v = in.Vector;
+				const float k = in.Value;
+
+				//Split by kind of op like the batched evaluator
+				if (in.Op < OP_MIN) {
+					const Interval* p = points + in.A * 3;
+					Interval& d = distances[in.Out];
+					switch (in.Op) {
+					case OP_SPHERE:
+						d = Sqrt(Square(p[0]) + Square(p[1]) + Square(p[2])) - k;
+						break;
+					case OP_BOX: {
+						Interval q[3];
+						for (int axis = 0; axis < 3; axis++)
+							q[axis] = Abs(p[axis]) - v[axis];
+						Interval outside = Sqrt(Square(Max(q[0], 0.f)) + Square(Max(q[1], 0.f)) + Square(Max(q[2], 0.f)));
+						d = outside + Min(Max(q[0], Max(q[1], q[2])), 0.f);
+						break;
+					}
+					case OP_PLANE:
+						d = p[0] * v.x + p[1] * v.y + p[2] * v.z + k;
+						break;
+					case OP_TORUS: {
+						Interval qx = Sqrt(Square(p[0]) + Square(p[2])) - v.x;
+						d = Sqrt(Square(qx) + Square(p[1])) - v.y;
+						break;
+					}
+					case OP_CYLINDER: {
+						Interval qx = Sqrt(Square(p[0]) + Square(p[2])) - v.x, qy = Abs(p[1]) - v.y;
+						d = Min(Max(qx, qy), 0.f) + Sqrt(Square(Max(qx, 0.f)) + Square(Max(qy, 0.f)));
+						break;
+					}
+					default:
+						break;
+					}
+				}
+				else if (in.Op < OP_TRANSLATE) {
+					Interval a = distances[in.A], b = distances[in.B];
+					Interval& d = distances[in.Out];
+					switch (in.Op) {
+					case OP_MIN:
+						d = Min(a, b);
+						break;
+					case OP_MAX:
+						d = Max(a, b);
+						break;
+					case OP_SUBTRACT:
+						d = Max(a, -b);
+						break;
+					//The polynomial blends never stray further than k / 4 from the hard version, which bounds far tighter than expanding the formula
+					case OP_SMOOTH_UNION:
+						d = Min(a, b);
+						d.Min -= k * 0.25f;
+						break;
+					case OP_SMOOTH_INTERSECTION:
+						d = Max(a, b);
+						d.Max += k * 0.25f;
+						break;
+					case OP_SMOOTH_SUBTRACTION:
+						d = Max(a, -b);
+						d.Max += k * 0.25f;
+						break;
+					case OP_MULTIPLY:
+						d = a * k;
+						break;
+					default:
+						break;
+					}
+				}
+				else {
+					const Interval* p = points + in.A * 3;
+					Interval* o = points + in.Out * 3;
+					switch (in.Op) {
+					case OP_TRANSLATE:
+						for (int axis = 0; axis < 3; axis++)
+							o[axis] = p[axis] - v[axis];
+						break;
+					case OP_ROTATE:
+						for (int row = 0; row < 3; row++)
+							o[row] = p[0] * in.Matrix[0][row] + p[1] * in.Matrix[1][row] + p[2] * in.Matrix[2][row];
+						break;
+					case OP_SCALE:
+						for (int axis = 0; axis < 3; axis++)
+							o[axis] = p[axis] * k;
+						break;
+					case OP_REPEAT:
+						for (int axis = 0; axis < 3; axis++) {
+							float c = v[axis];
+							if (c <= 0.f) {
+								o[axis] = p[axis];
+								continue;
+							}
+							//If the whole range falls in one cell it's just shifted, otherwise it could be anywhere in a cell
+							float cellMin = std::floor(p[axis].Min / c + 0.5f), cellMax = std::floor(p[axis].Max / c + 0.5f);
+							if (cellMin == cellMax)
+								o[axis] = p[axis] - c * cellMin;
+							else
+								o[axis] = Interval(-0.5f * c, 0.5f * c);
+						}
+						break;
+					default:
+						break;
+					}
+				}
+			}
+
+			return distances[m_result];
+		}
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+
+#include "Expression.h"
+#include "Interval.h"
+#include "Dual.h"
+
+/*
+	An expression flattened into a list of instructions, which is what the evaluators and code generators work from.
+	Registers are only ever written once, point registers and distance registers are numbered separately and point register 0 is the input.
+*/
+
+namespace marcher {
+	namespace sdf {
+		enum OpCode {
+			//Point register A to distance
+			OP_SPHERE,
+			OP_BOX,
+			OP_PLANE,
+			OP_TORUS,
+			OP_CYLINDER,
+			//Distance registers A and B to distance
+			OP_MIN,
+			OP_MAX,
+			OP_SUBTRACT,
+			OP_SMOOTH_UNION,
+			OP_SMOOTH_INTERSECTION,
+			OP_SMOOTH_SUBTRACTION,
+			//Distance register A times Value
+			OP_MULTIPLY,
+			//Point register A to point
+			OP_TRANSLATE,
+			OP_ROTATE,
+			OP_SCALE,
+			OP_REPEAT
+		};
+
+		struct Instruction {
+			OpCode Op;
+			int Out, A, B;
+			glm::vec3 Vector;
+			float Value;
+			glm::mat3 Matrix;
+		};
+
+		class Program {
+		public:
+			Program(const Expr& scene);
+
+			float Evaluate(const glm::vec3& p) const;
+			//Evaluates the distance and its gradient together with dual numbers
+			float Evaluate(const glm::vec3& p, glm::vec3& gradient) const;
+			//Evaluates count points given as separate x, y and z arrays, in batches of BatchSize with one tight loop per instruction
+			void Evaluate(const float* x, const float* y, const float* z, float* out, int count) const;
+			//Bounds the distance at every point of the box from min to max. The bounds are conservative, not tight
+			Interval Bound(const glm::vec3& min, const glm::vec3& max) const;
+
+			const std::vector<Instruction>& Instructions() const { return m_instructions; }
+			int PointRegisters() const { return m_pointRegisters; }
+			int DistanceRegisters() const { return m_distanceRegisters; }
+			//The distance register holding the scene's distance
+			int Result() const { return m_result; }
+
+			static const int BatchSize = 64;
+
+		private:
+			int CompileDistance(const Node& node, int point);
+			int CompilePoint(const Node& node, int point);
+			void EvaluateBatch(const float* x, const float* y, const float* z, float* out, int count, float* registers) const;
+
+			std::vector<Instruction> m_instructions;
+			int m_pointRegisters, m_distanceRegisters, m_result;
+		};
+	}
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "Maths.h"
+
+namespace marcher {
+	//Sub-pixel position of sample index out of count, from the R2 low discrepancy sequence. A single sample sits in the pixel centre
+	inline glm::vec2 SampleOffset(int index, int count) {
+		if (count <= 1)
+			return glm::vec2(0.5f);
+		const double a1 = 0.7548776662466927, a2 = 0.5698402909980532;
+		double x = 0.5 + a1 * index, y = 0.5 + a2 * index;
+		return glm::vec2((float)(x - std::floor(x)), (float)(y - std::floor(y)));
+	}
+}
@@ -1,5 +1,12 @@
 #version 330 core
-out vec4 FragColor;
+// The compute marcher builds its program from this same header with COMPUTE_MARCH defined, which leaves out the fragment entry point
+#ifndef COMPUTE_MARCH
+layout(location = 0) out vec4 FragColor;
+// World position of the primary hit with w set to 1, or 0 on a miss. Kept around to start next frame's rays from
+layout(location = 1) out vec4 HitPosition;
+// Normal in xyz and material ID in w, only written by the geometry pass
+layout(location = 2) out vec4 SurfaceNormal;
+#endif
 
 struct Camera {
     vec3 Position, Target;
@@ -13,10 +20,38 @@ struct Ray {
 uniform float EPSILON;
 uniform float MAX_DISTANCE;
 uniform int MAX_MARCHING_STEPS;
+// Primary rays step this many times the distance while that stays safe, 1 is plain sphere tracing
+uniform float MarchRelaxation;
 
 uniform bool ShadowsEnabled;
 uniform float ShadowStrength;
+// Shadow rays give up as lit after SHADOW_STEPS steps or SHADOW_DISTANCE, or once they leave SceneMin to SceneMax when SceneBounded is set
+uniform int SHADOW_STEPS;
+uniform float SHADOW_DISTANCE;
+uniform bool SceneBounded;
+uniform vec3 SceneMin, SceneMax;
+// How sharp the penumbra is, 0 gives hard shadows
+uniform float ShadowSoftness;
+// Baked distance along the light to the first hit, looked up instead of marching a shadow ray where the map covers.
+// It only knows whether the light is blocked, so with a soft penumbra it only stands in for the ray where p is fully blocked.
+// ShadowMapTransform takes a world position to its texel in xy and its distance along the light in z
+uniform bool ShadowMapEnabled;
+uniform sampler2D ShadowMap;
+uniform mat4 ShadowMapTransform;
+uniform float ShadowMapTexel;
+// The bake pass marches one ray along the light per texel, starting from where ShadowMapInverse puts the texel
+uniform bool ShadowBake;
+uniform mat4 ShadowMapInverse;
+
 uniform float AOStrength;
+// Occlusion baked over AOVolumeMin to AOVolumeMax, looked up instead of tapping the scene where the volume covers
+uniform bool AOVolumeEnabled;
+uniform sampler3D AOVolume;
+uniform vec3 AOVolumeMin, AOVolumeMax;
+// The bake pass fills slice AOBakeSlice of a volume with AOVolumeResolution voxels
+uniform bool AOBake;
+uniform int AOBakeSlice;
+uniform vec3 AOVolumeResolution;
 
 uniform vec3 AmbientColor;
 uniform vec3 LightColor;
@@ -26,10 +61,75 @@ uniform vec2 ScreenSize;
 uniform Camera MainCamera;
 uniform float Time;
 
+// 0 shades normally, 1 shows primary steps, 2 shadow steps and 3 SceneSDF calls, scaled so HeatmapScale is red
+uniform int DebugView;
+uniform float HeatmapScale;
+// Writes the raw counts (primary steps, shadow steps, SceneSDF calls) instead of a color, used to read them back
+uniform bool DebugRaw;
+
+// The low resolution pass writes how far the rays of each block of PrepassScale x PrepassScale pixels can skip,
+// the full resolution pass then starts marching from there
+uniform bool DepthPrepass;
+uniform bool PrepassEnabled;
+uniform int PrepassScale;
+uniform sampler2D PrepassDepth;
+
+// Depth along each ray at which last frame's closest reprojected hit landed, huge where nothing did
+uniform bool HistoryEnabled;
+uniform float HistoryBackoff;
+uniform sampler2D HistoryDepth;
+
+// Only pixels where x + y + CheckerboardParity is even get marched, the rest are filled in afterwards
+uniform bool CheckerboardEnabled;
+uniform int CheckerboardParity;
+
+// Level from 0 to 1 in thirds per QualityTileSize x QualityTileSize tile, lower levels march coarser and skip AO, the lowest skips shadows too
+uniform bool VariableRate;
+uniform int QualityTileSize;
+uniform sampler2D QualityMap;
+
+// The geometry pass only marches, and writes the march's depth, steps, Grazing and SDF calls to FragColor instead of a color.
+// The lighting pass shades from what it wrote without marching again, with neither set both happen in one pass
+uniform bool GeometryPass;
+uniform bool LightingPass;
+uniform sampler2D GBufferMarch;
+uniform sampler2D GBufferPosition;
+uniform sampler2D GBufferSurface;
+
+// The edge pass marches EdgeSamples more rays for each pixel set in EdgeMask, to blend over the one already lit
+uniform bool EdgeResample;
+uniform int EdgeSamples;
+uniform sampler2D EdgeMask;
+
+// A distance volume over SparseMin to SparseMax that only keeps its voxels near the surface. SparseIndex has an entry per 8^3 brick of
+// SparseDimensions: below SparseResident it's the brick's slot in SparseAtlas, past that it counts the whole SparseBands the brick stays
+// from the surface, doubled and plus one if inside. The atlas has SparseSlots.x by SparseSlots.y slots a layer, each a brick and the voxels
+// after it in fractions of SparseBand
+uniform usampler3D SparseIndex;
+uniform sampler3D SparseAtlas;
+uniform vec3 SparseMin, SparseMax;
+uniform ivec3 SparseDimensions;
+uniform ivec2 SparseSlots;
+uniform float SparseBand;
+uniform int SparseResident;
+
+float StartDepth = 0.f;
+// EPSILON, MAX_MARCHING_STEPS and ShadowsEnabled after the tile's quality level is applied
+float Epsilon;
+int MarchSteps;
+bool UseShadows, UseAO = true;
+
+int PrimarySteps = 0;
+int ShadowSteps = 0;
+int SDFCalls = 0;
+int Material = 0;
+// Smallest ratio of distance to the scene over distance travelled the primary ray saw, a miss that grazed a surface has a small one
+float Grazing = 1e10;
+
 //uniform sampler3D Model;
 
-Ray CalculateFragRay() {
-    vec2 RelScreenPos = gl_FragCoord.xy / ScreenSize;
+Ray CalculateRay(in vec2 fragCoord) {
+    vec2 RelScreenPos = fragCoord / ScreenSize;
 
     vec3 TopPos = mix(MainCamera.TopLeft, MainCamera.TopRight, RelScreenPos.x);
     vec3 BottomPos = mix(MainCamera.BottomLeft, MainCamera.BottomRight, RelScreenPos.x);
@@ -37,8 +137,36 @@ Ray CalculateFragRay() {
     return Ray(FinalPos, normalize(FinalPos-MainCamera.Position));
 }
 
+#ifndef COMPUTE_MARCH
+Ray CalculateFragRay() {
+    return CalculateRay(gl_FragCoord.xy);
+}
+#endif
+
 float SceneSDF(in vec3 p);
 
+#ifdef SCENE_MATERIAL
+// Scenes with materials give the ID of the surface nearest to p, and the color each ID reflects
+int SceneMaterial(in vec3 p);
+vec3 MaterialColor(in int material);
+#endif
+
+// Distance from the sparse volume a scene loads with "#pragma volume <model> [band voxels]", points outside it get the distance at its nearest voxel
+float SparseDistance(in vec3 p) {
+    vec3 voxel = clamp((p - SparseMin) / (SparseMax - SparseMin) * vec3(SparseDimensions) - 0.5, vec3(0), vec3(SparseDimensions - 1));
+    ivec3 brick = ivec3(voxel) / 8;
+    uint entry = texelFetch(SparseIndex, brick, 0).r;
+    if (entry >= uint(SparseResident)) {
+        uint code = entry - uint(SparseResident);
+        return ((code & 1u) != 0u ? -1.0 : 1.0) * float(code >> 1) * SparseBand;
+    }
+    int slot = int(entry);
+    ivec3 origin = ivec3(slot % SparseSlots.x, (slot / SparseSlots.x) % SparseSlots.y, slot / (SparseSlots.x * SparseSlots.y)) * 9;
+    // The slot has the voxels after the brick too, so the hardware filter never blends in a neighbouring slot
+    vec3 texel = vec3(origin) + voxel - vec3(brick * 8) + 0.5;
+    return texture(SparseAtlas, texel / vec3(textureSize(SparseAtlas, 0))).r * SparseBand;
+}
+
 // float s = 100000;
 // if (sdBox(p - vec3(1), vec3(1)) <= EPSILON) {
 //     s = texture(Model, p * vec3(1.f/2)).r;
@@ -70,17 +198,26 @@ float SceneSDF(in vec3 p);
     return min(sphereSDF(SDFRepitition(p, vec3(6,6,6)), vec3(0)), p.y);
 }*/
 
-vec3 EstimateNormal(in vec3 p) {
-    vec3 small_step = vec3(EPSILON, 0.0, 0.0);
+#ifdef SCENE_GRADIENT
+// Generated scenes come with their gradient in xyz and the distance in w, so a normal costs one evaluation
+vec4 SceneGradient(in vec3 p);
 
-    float gradient_x = SceneSDF(p + small_step.xyy) - SceneSDF(p - small_step.xyy);
-    float gradient_y = SceneSDF(p + small_step.yxy) - SceneSDF(p - small_step.yxy);
-    float gradient_z = SceneSDF(p + small_step.yyx) - SceneSDF(p - small_step.yyx);
+vec3 EstimateNormal(in vec3 p) {
+    SDFCalls++;
+    return normalize(SceneGradient(p).xyz);
+}
+#else
+// Four taps on the corners of a tetrahedron, instead of six on the axes
+vec3 EstimateNormal(in vec3 p) {
+    vec2 k = vec2(1, -1);
+    SDFCalls += 4;
 
-    vec3 normal = vec3(gradient_x, gradient_y, gradient_z);
+    vec3 normal = k.xyy * SceneSDF(p + k.xyy * Epsilon) + k.yyx * SceneSDF(p + k.yyx * Epsilon)
+                + k.yxy * SceneSDF(p + k.yxy * Epsilon) + k.xxx * SceneSDF(p + k.xxx * Epsilon);
 
     return normalize(normal);
 }
+#endif
 
 struct MarchInfo {
     bool Hit;
@@ -90,37 +227,132 @@ struct MarchInfo {
 };
 
 MarchInfo March(in Ray ray) {
-    float depth = 0.f;
+    float depth = StartDepth;
     float dist, minDist = MAX_DISTANCE;
+    // Over-relaxed steps are only safe while each new sphere overlaps the last one, and landing inside the surface would put the hit in the wrong place.
+    // Either way the step is undone and the ray carries on unrelaxed
+    float relaxation = MarchRelaxation;
+    float stepLength = 0.f, lastDist = 0.f;
     int i = 0;
-    for (; i < MAX_MARCHING_STEPS; i++) {
+    for (; i < MarchSteps; i++) {
         dist = SceneSDF(ray.Origin + (ray.Direction * depth));
+        SDFCalls++;
+        if (relaxation > 1.f && (dist < 0.f || dist + lastDist < stepLength)) {
+            depth -= stepLength - lastDist;
+            relaxation = 1.f;
+            continue;
+        }
         minDist = min(dist, minDist);
-        if (dist < EPSILON) {
+        Grazing = min(Grazing, dist / max(depth, Epsilon));
+        if (dist < Epsilon) {
             if (dist < 0) {
                 depth += dist; depth += dist;
             }
             return MarchInfo(true, depth, dist, ray.Origin + (ray.Direction * depth), EstimateNormal(ray.Origin + (ray.Direction * depth)), i);
         }
-        depth += dist;
-        if (depth >= MAX_DISTANCE) {
+        // Only the unrelaxed step is known to be empty, so that's what has to reach MAX_DISTANCE
+        if (depth + dist >= MAX_DISTANCE) {
+            depth += dist;
             return MarchInfo(false, depth, minDist, ray.Origin + (ray.Direction * depth), vec3(0), i);
         }
+        lastDist = dist;
+        stepLength = dist * relaxation;
+        depth += stepLength;
     }
     return MarchInfo(false, depth, minDist, ray.Origin + (ray.Direction * depth), vec3(0), i);
 }
 
+// Marches a cone that holds the rays of every pixel this fragment covers and returns a depth all of them can start from
+float ConeMarch(in Ray ray) {
+    // Rays drift apart by at most half the fragment's diagonal on the near plane, growing linearly with the distance from the camera
+    vec2 pixel = vec2(distance(MainCamera.TopLeft, MainCamera.TopRight), distance(MainCamera.TopLeft, MainCamera.BottomLeft)) / ScreenSize;
+    float near = distance(MainCamera.Position, ray.Origin);
+    float spread = 0.5 * length(pixel) / dot(ray.Origin - MainCamera.Position, normalize(MainCamera.Target - MainCamera.Position));
+
+    float depth = 0.f;
+    for (int i = 0; i < MarchSteps && depth < MAX_DISTANCE; i++) {
+        float radius = (near + depth) * spread;
+        float dist = SceneSDF(ray.Origin + ray.Direction * depth);
+        if (dist < radius + Epsilon) {
+            break;
+        }
+        // The cone keeps widening over the step, so it has to stop short of the sphere's edge
+        depth += (dist - radius) / (1.0 + spread);
+    }
+    return max(depth - (near + depth) * spread, 0.f);
+}
+
+// How far along a ray towards the light something could still block it
+float ShadowRange(in Ray ray) {
+    float range = SHADOW_DISTANCE;
+    if (SceneBounded) {
+        vec3 direction = mix(ray.Direction, vec3(1e-6), equal(ray.Direction, vec3(0)));
+        vec3 exit = max((SceneMin - ray.Origin) / direction, (SceneMax - ray.Origin) / direction);
+        range = min(range, min(exit.x, min(exit.y, exit.z)));
+    }
+    return range;
+}
+
+// Returns how much light gets through, from 0 to 1. The closest the ray comes to a surface relative to how far along it is
+// gives the penumbra, so it costs nothing over a hard shadow
 float Shadow(in Ray ray) {
-    for(float t=EPSILON; t<MAX_DISTANCE;) {
+    float range = ShadowRange(ray);
+    float light = 1.0;
+    float t = Epsilon;
+    for (int i = 0; i < SHADOW_STEPS && t < range; i++) {
         float h = SceneSDF(ray.Origin + ray.Direction*t);
-        if(h<EPSILON)
-            return 0;
+        ShadowSteps++;
+        SDFCalls++;
+        if (ShadowSoftness > 0) {
+            light = min(light, ShadowSoftness * h / t);
+        }
+        if (h < Epsilon || light < 0.01)
+            return 0.0;
         t += h;
     }
-    return 1;
+    return light;
 }
 
-float genAmbientOcclusion(vec3 ro, vec3 rd) {
+// Where along the light the ray through a texel of the shadow map first hits something, measured the same way as ShadowMapTransform's z
+float BakeShadowDepth(in vec2 uv) {
+    vec3 origin = (ShadowMapInverse * vec4(uv, 0, 1)).xyz;
+    vec3 direction = normalize(LightDir);
+    vec3 safeDirection = mix(direction, vec3(1e-6), equal(direction, vec3(0)));
+    vec3 t0 = (SceneMin - origin) / safeDirection, t1 = (SceneMax - origin) / safeDirection;
+    vec3 entry = min(t0, t1), exit = max(t0, t1);
+    float t = max(entry.x, max(entry.y, entry.z));
+    float far = min(exit.x, min(exit.y, exit.z));
+    for (int i = 0; i < MAX_MARCHING_STEPS && t < far; i++) {
+        float dist = SceneSDF(origin + direction * t);
+        if (dist < Epsilon) {
+            return t;
+        }
+        t += dist;
+    }
+    return 1e30;
+}
+
+// How much light reaches p going by the shadow map, with the four nearest texels blended. -1 where the map doesn't cover p
+float ShadowMapLight(in vec3 p, in vec3 normal) {
+    // Moving a texel off the surface keeps it from shadowing itself
+    vec3 light = (ShadowMapTransform * vec4(p + normal * ShadowMapTexel, 1)).xyz;
+    if (any(lessThan(light.xy, vec2(0))) || any(greaterThan(light.xy, vec2(1)))) {
+        return -1.0;
+    }
+    ivec2 size = textureSize(ShadowMap, 0);
+    vec2 texel = light.xy * vec2(size) - 0.5;
+    ivec2 base = ivec2(floor(texel));
+    vec2 f = texel - vec2(base);
+    float lit[4];
+    for (int i = 0; i < 4; i++) {
+        ivec2 tap = clamp(base + ivec2(i & 1, i >> 1), ivec2(0), size - 1);
+        lit[i] = light.z <= texelFetch(ShadowMap, tap, 0).r + ShadowMapTexel ? 1.0 : 0.0;
+    }
+    return mix(mix(lit[0], lit[1], f.x), mix(lit[2], lit[3], f.x), f.y);
+}
+
+// Weighted sum of how far taps along rd from ro end up inside the scene
+float OcclusionTaps(vec3 ro, vec3 rd) {
     vec4 totao = vec4(0.0);
     float sca = 1.0;
 
@@ -128,47 +360,219 @@ float genAmbientOcclusion(vec3 ro, vec3 rd) {
         float hr = 0.01 + 0.02 * float(aoi * aoi);
         vec3 aopos = ro + rd * hr;
         float dd = SceneSDF(aopos);
+        SDFCalls++;
         float ao = clamp(-(dd - hr), 0.0, 1.0);
         totao += ao * sca * vec4(1.0, 1.0, 1.0, 1.0);
         sca *= 0.75;
     }
     
-    return 1.0 - clamp(AOStrength * totao.w, 0.0, 1.0);
+    return totao.w;
+}
+
+float genAmbientOcclusion(vec3 ro, vec3 rd) {
+    return 1.0 - clamp(AOStrength * OcclusionTaps(ro, rd), 0.0, 1.0);
+}
+
+// The occlusion of the surface nearest to p, which is what each voxel of the AO volume holds
+float BakeOcclusion(in vec3 p) {
+    float dist = SceneSDF(p);
+    // Lookups only blend voxels within one of the surface, past that and the taps' reach there's nothing to store
+    float voxel = length((AOVolumeMax - AOVolumeMin) / AOVolumeResolution);
+    if (dist > max(0.5, 2.0 * voxel)) {
+        return 0.0;
+    }
+    vec3 normal = EstimateNormal(p);
+    return OcclusionTaps(p - normal * dist + normal * Epsilon, normal);
 }
 
-vec3 Render(in Ray ray) {
-    MarchInfo info = March(ray);
+// Occlusion from the AO volume, -1 where it doesn't cover p
+float VolumeOcclusion(in vec3 p) {
+    vec3 uvw = (p - AOVolumeMin) / (AOVolumeMax - AOVolumeMin);
+    if (any(lessThan(uvw, vec3(0))) || any(greaterThan(uvw, vec3(1)))) {
+        return -1.0;
+    }
+    return texture(AOVolume, uvw).r;
+}
 
+vec3 Shade(in Ray ray, in MarchInfo info) {
     if (info.Hit) {
         float shadow = 0.f;
-        if (ShadowsEnabled) {
-            shadow = 1.f-Shadow(Ray(info.Position + info.Normal * EPSILON*2, normalize(-LightDir)));
+        // Surfaces facing away from the light are unlit either way
+        float diffuse = dot(info.Normal, normalize(-LightDir));
+        if (UseShadows && diffuse > 0.f) {
+            float light = ShadowMapEnabled ? ShadowMapLight(info.Position, info.Normal) : -1.0;
+            // Blocked rays give no light with or without a penumbra, but only the ray knows how close it came to blocking
+            if (light < 0.0 || (ShadowSoftness > 0 && light > 0.0)) {
+                light = Shadow(Ray(info.Position + info.Normal * Epsilon*2, normalize(-LightDir)));
+            }
+            shadow = 1.f-light;
         }
         
-        vec3 ret = LightColor * max(dot(info.Normal, normalize(-LightDir)), 0.f);
+        vec3 ret = LightColor * max(diffuse, 0.f);
+#ifdef SCENE_MATERIAL
+        ret *= MaterialColor(Material);
+#endif
         ret -= vec3(shadow * ShadowStrength) * ret;
         ret += AmbientColor * (vec3(1)-ret);
 
-        ret *= genAmbientOcclusion(info.Position + info.Normal * EPSILON, info.Normal);
+        if (UseAO) {
+            float occlusion = AOVolumeEnabled ? VolumeOcclusion(info.Position) : -1.0;
+            if (occlusion < 0.0) {
+                ret *= genAmbientOcclusion(info.Position + info.Normal * Epsilon, info.Normal);
+            }
+            else {
+                ret *= 1.0 - clamp(AOStrength * occlusion, 0.0, 1.0);
+            }
+        }
         return mix(ret * vec3(1.f), AmbientColor, distance(ray.Origin, info.Position)/MAX_DISTANCE);
     }
     return AmbientColor;
 }
 
+#ifndef COMPUTE_MARCH
+// The average of EdgeSamples more rays spread over the pixel, after the one through its centre
+vec3 Resample() {
+    vec3 color = vec3(0);
+    for (int i = 1; i <= EdgeSamples; i++) {
+        // R2 sequence offsets, the same ones the accumulated samples use
+        vec2 offset = fract(0.5 + float(i) * vec2(0.7548776662466927, 0.5698402909980532)) - 0.5;
+        Ray ray = CalculateRay(gl_FragCoord.xy + offset);
+        MarchInfo info = March(ray);
+#ifdef SCENE_MATERIAL
+        if (info.Hit) {
+            Material = SceneMaterial(info.Position);
+        }
+#endif
+        color += Shade(ray, info);
+    }
+    return color / float(EdgeSamples);
+}
+
 void SetDiffuse(in vec3 col) {
 
 }
 
+vec3 Heatmap(float t) {
+    t = clamp(t, 0.0, 1.0);
+    return clamp(vec3(1.5) - abs(4.0 * t - vec3(3.0, 2.0, 1.0)), 0.0, 1.0);
+}
+
 void main() {
     Ray CamRay = CalculateFragRay();
 
-    if (SceneSDF(CamRay.Origin) < EPSILON) {
+    Epsilon = EPSILON;
+    MarchSteps = MAX_MARCHING_STEPS;
+    UseShadows = ShadowsEnabled;
+    if (VariableRate && !DepthPrepass && !ShadowBake && !AOBake) {
+        // Each level below full doubles the epsilon and takes a quarter of the steps away
+        int level = int(texelFetch(QualityMap, ivec2(gl_FragCoord.xy) / QualityTileSize, 0).r * 3.0 + 0.5);
+        Epsilon *= exp2(float(3 - level));
+        MarchSteps = MAX_MARCHING_STEPS * (level + 1) / 4;
+        UseAO = level >= 2;
+        UseShadows = UseShadows && level >= 1;
+    }
+
+    if (ShadowBake) {
+        FragColor = vec4(BakeShadowDepth(gl_FragCoord.xy / ScreenSize), 0, 0, 1);
+        return;
+    }
+    if (AOBake) {
+        vec3 voxel = vec3(gl_FragCoord.xy, float(AOBakeSlice) + 0.5) / AOVolumeResolution;
+        FragColor = vec4(BakeOcclusion(mix(AOVolumeMin, AOVolumeMax, voxel)), 0, 0, 1);
+        return;
+    }
+    if (DepthPrepass) {
+        FragColor = vec4(ConeMarch(CamRay), 0, 0, 1);
+        return;
+    }
+    if (EdgeResample) {
+        if (texelFetch(EdgeMask, ivec2(gl_FragCoord.xy), 0).r < 0.5) {
+            discard;
+        }
+        // Blended so the pixel ends up as the average of all its samples
+        FragColor = vec4(Resample(), float(EdgeSamples) / float(EdgeSamples + 1));
+        return;
+    }
+    if (CheckerboardEnabled && ((int(gl_FragCoord.x) + int(gl_FragCoord.y) + CheckerboardParity) & 1) != 0) {
+        discard;
+    }
+
+    // A depth of -1 marks a camera that's inside the surface
+    MarchInfo info;
+    bool inside;
+    if (LightingPass) {
+        ivec2 pixel = ivec2(gl_FragCoord.xy);
+        vec4 march = texelFetch(GBufferMarch, pixel, 0);
+        vec4 position = texelFetch(GBufferPosition, pixel, 0);
+        vec4 surface = texelFetch(GBufferSurface, pixel, 0);
+        inside = march.x < 0;
+        // The G-buffer keeps how closely the ray grazed the scene instead of its closest distance, nothing is shaded from either
+        info = MarchInfo(position.w != 0, march.x, 0.0, position.xyz, surface.xyz, int(march.y));
+        SDFCalls = int(march.w);
+        Material = int(surface.w);
+    }
+    else {
+        if (PrepassEnabled) {
+            StartDepth = texelFetch(PrepassDepth, ivec2(gl_FragCoord.xy) / PrepassScale, 0).r;
+        }
+        if (HistoryEnabled) {
+            // Something may have moved in front of last frame's hit, so the start is only trusted if it's still outside the surface
+            float history = texelFetch(HistoryDepth, ivec2(gl_FragCoord.xy), 0).r * (1.0 - HistoryBackoff);
+            if (history < MAX_DISTANCE && history > StartDepth) {
+                SDFCalls++;
+                if (SceneSDF(CamRay.Origin + CamRay.Direction * history) > Epsilon) {
+                    StartDepth = history;
+                }
+            }
+        }
+
+        SDFCalls++;
+        inside = SceneSDF(CamRay.Origin) < Epsilon;
+        if (inside) {
+            info = MarchInfo(false, -1.0, 0.0, CamRay.Origin, vec3(0), 0);
+        }
+        else {
+            info = March(CamRay);
+        }
+#ifdef SCENE_MATERIAL
+        if (info.Hit) {
+            Material = SceneMaterial(info.Position);
+        }
+#endif
+    }
+
+    PrimarySteps = info.Steps;
+    HitPosition = vec4(info.Position, info.Hit ? 1 : 0);
+    if (GeometryPass) {
+        FragColor = vec4(info.Depth, info.Steps, Grazing, SDFCalls);
+        SurfaceNormal = vec4(info.Normal, Material);
+        return;
+    }
+
+    if (inside) {
+        HitPosition = vec4(0);
         FragColor = vec4(0,0,0,1);
     }
     else {
-        FragColor = vec4(Render(CamRay), 1.f);
+        FragColor = vec4(Shade(CamRay, info), 1.f);
+    }
+
+    if (DebugRaw) {
+        FragColor = vec4(PrimarySteps, ShadowSteps, SDFCalls, 1);
+    }
+    else if (DebugView == 1) {
+        FragColor = vec4(Heatmap(PrimarySteps / HeatmapScale), 1);
+    }
+    else if (DebugView == 2) {
+        FragColor = vec4(Heatmap(ShadowSteps / HeatmapScale), 1);
+    }
+    else if (DebugView == 3) {
+        FragColor = vec4(Heatmap(SDFCalls / HeatmapScale), 1);
     }
 }
+#endif
+
+#pragma bounds -100000 -1 -100000 100000 2.1 100000
 
 float SceneSDF(in vec3 p) {
     float sphere = distance(p + vec3(sin(p.x*20)*0.01), vec3(0, 1, 0)) - 1;
@@ -5,14 +5,32 @@
 #include "Engine/Graphics/Camera.h"
 #include "Engine/Timer.h"
 #include "Engine/Graphics/VolumetricModel.h"
+#include "Engine/Graphics/SparseVolume.h"
+#include "Engine/Graphics/TiledRenderer.h"
+#include "Engine/Graphics/RenderTarget.h"
+#include "Engine/Graphics/DepthReprojector.h"
+#include "Engine/Graphics/CheckerboardResolver.h"
+#include "Engine/Graphics/QualityMap.h"
+#include "Engine/Graphics/ShadowBaker.h"
+#include "Engine/Graphics/AOBaker.h"
+#include "Engine/Graphics/GBuffer.h"
+#include "Engine/Graphics/Accumulator.h"
+#include "Engine/Graphics/EdgeResampler.h"
+#include "Engine/Graphics/ComputeMarcher.h"
+#include "Engine/Graphics/GpuTimer.h"
+#include "Engine/Graphics/ResolutionController.h"
+#include "Engine/CPU/Renderer.h"
+#include "Engine/PngWriter.h"
+
+#include <sstream>
 
 
 #include "Engine/ImGUI/imgui.h"
 #include "Engine/ImGUI/imgui-SFML.h"
 
-std::string HeaderFS = "#version 330 core\nout vec4 FragColor;\n\nstruct Camera {\n    vec3 Position, Target;\n    vec3 TopLeft, TopRight, BottomLeft, BottomRight;\n};\n\nstruct Ray {\n    vec3 Origin, Direction;\n};\n\nuniform float EPSILON;\nuniform float MAX_DISTANCE;\nuniform int MAX_MARCHING_STEPS;\n\nuniform bool ShadowsEnabled;\nuniform float ShadowStrength;\nuniform float AOStrength;\n\nuniform vec3 AmbientColor;\nuniform vec3 LightColor;\nuniform vec3 LightDir;\n\nuniform vec2 ScreenSize;\nuniform Camera MainCamera;\nuniform float Time;\n\n//uniform sampler3D Model;\n\nRay CalculateFragRay() {\n    vec2 RelScreenPos = gl_FragCoord.xy / ScreenSize;\n\n    vec3 TopPos = mix(MainCamera.TopLeft, MainCamera.TopRight, RelScreenPos.x);\n    vec3 BottomPos = mix(MainCamera.BottomLeft, MainCamera.BottomRight, RelScreenPos.x);\n    vec3 FinalPos = mix(TopPos, BottomPos, RelScreenPos.y);\n    return Ray(FinalPos, normalize(FinalPos-MainCamera.Position));\n}\n\nfloat SceneSDF(in vec3 p);\n\n// float s = 100000;\n// if (sdBox(p - vec3(1), vec3(1)) <= EPSILON) {\n//     s = texture(Model, p * vec3(1.f/2)).r;\n// }\n// else {\n//     s = sdBox(p - vec3(1), vec3(1));\n// }\n// float f = sphereSDF(SDFRepitition(p, vec3(6,0,6)), vec3(0));\n// if (f <= EPSILON) {\n//     //f = max(f, cnoise(p+vec3(Time)));\n// }\n\n// return min(min(s, f), p.y);\n\n/*float SceneSDFAO(in vec3 p) {\n    // float s = 100000;\n    // if (sdBox(p - vec3(1), vec3(1)) <= EPSILON) {\n    //     s = texture(Model, p * vec3(1.f/2)).r;\n    // }\n    // else if (sdBox(p - vec3(1), vec3(1)) <= 0.5) {\n    //     s = sdBox(p - vec3(1), vec3(1)) + texture(Model, p * vec3(1.f/2)).r;\n    // }\n    // float f = sphereSDF(SDFRepitition(p, vec3(6,0,6)), vec3(0));\n    // if (f <= EPSILON) {\n    //     //f = max(f, cnoise(p+vec3(Time)));\n    // }\n\n    // return min(min(s, f), p.y);\n    return min(sphereSDF(SDFRepitition(p, vec3(6,6,6)), vec3(0)), p.y);\n}*/\n\nvec3 EstimateNormal(in vec3 p) {\n    vec3 small_step = vec3(EPSILON, 0.0, 0.0);\n\n    float gradient_x = SceneSDF(p + small_step.xyy) - SceneSDF(p - small_step.xyy);\n    float gradient_y = SceneSDF(p + small_step.yxy) - SceneSDF(p - small_step.yxy);\n    float gradient_z = SceneSDF(p + small_step.yyx) - SceneSDF(p - small_step.yyx);\n\n    vec3 normal = vec3(gradient_x, gradient_y, gradient_z);\n\n    return normalize(normal);\n}\n\nstruct MarchInfo {\n    bool Hit;\n    float Depth, MinDistance;\n    vec3 Position, Normal;\n    int Steps;\n};\n\nMarchInfo March(in Ray ray) {\n    float depth = 0.f;\n    float dist, minDist = MAX_DISTANCE;\n    int i = 0;\n    for (; i < MAX_MARCHING_STEPS; i++) {\n        dist = SceneSDF(ray.Origin + (ray.Direction * depth));\n        minDist = min(dist, minDist);\n        if (dist < EPSILON) {\n            if (dist < 0) {\n                depth += dist; depth += dist;\n            }\n            return MarchInfo(true, depth, dist, ray.Origin + (ray.Direction * depth), EstimateNormal(ray.Origin + (ray.Direction * depth)), i);\n        }\n        depth += dist;\n        if (depth >= MAX_DISTANCE) {\n            return MarchInfo(false, depth, minDist, ray.Origin + (ray.Direction * depth), vec3(0), i);\n        }\n    }\n    return MarchInfo(false, depth, minDist, ray.Origin + (ray.Direction * depth), vec3(0), i);\n}\n\nfloat Shadow(in Ray ray) {\n    for(float t=EPSILON; t<MAX_DISTANCE;) {\n        float h = SceneSDF(ray.Origin + ray.Direction*t);\n        if(h<EPSILON)\n            return 0;\n        t += h;\n    }\n    return 1;\n}\n\nfloat genAmbientOcclusion(vec3 ro, vec3 rd) {\n    vec4 totao = vec4(0.0);\n    float sca = 1.0;\n\n    for (int aoi = 0; aoi < 5; aoi++) {\n        float hr = 0.01 + 0.02 * float(aoi * aoi);\n        vec3 aopos = ro + rd * hr;\n        float dd = SceneSDF(aopos);\n        float ao = clamp(-(dd - hr), 0.0, 1.0);\n        totao += ao * sca * vec4(1.0, 1.0, 1.0, 1.0);\n        sca *= 0.75;\n    }\n    \n    return 1.0 - clamp(AOStrength * totao.w, 0.0, 1.0);\n}\n\nvec3 Render(in Ray ray) {\n    MarchInfo info = March(ray);\n\n    if (info.Hit) {\n        float shadow = 0.f;\n        if (ShadowsEnabled) {\n            shadow = 1.f-Shadow(Ray(info.Position + info.Normal * EPSILON*2, normalize(-LightDir)));\n        }\n        \n        vec3 ret = LightColor * max(dot(info.Normal, normalize(-LightDir)), 0.f);\n        ret -= vec3(shadow * ShadowStrength) * ret;\n        ret += AmbientColor * (vec3(1)-ret);\n\n        ret *= genAmbientOcclusion(info.Position + info.Normal * EPSILON, info.Normal);\n        return mix(ret * vec3(1.f), AmbientColor, distance(ray.Origin, info.Position)/MAX_DISTANCE);\n    }\n    return AmbientColor;\n}\n\nvoid SetDiffuse(in vec3 col) {\n\n}\n\nvoid main() {\n    Ray CamRay = CalculateFragRay();\n\n    if (SceneSDF(CamRay.Origin) < EPSILON) {\n        FragColor = vec4(0,0,0,1);\n    }\n    else {\n        FragColor = vec4(Render(CamRay), 1.f);\n    }\n}";
+std::string HeaderFS = "#version 330 core\n// The compute marcher builds its program from this same header with COMPUTE_MARCH defined, which leaves out the fragment entry point\n#ifndef COMPUTE_MARCH\nlayout(location = 0) out vec4 FragColor;\n// World position of the primary hit with w set to 1, or 0 on a miss. Kept around to start next frame's rays from\nlayout(location = 1) out vec4 HitPosition;\n// Normal in xyz and material ID in w, only written by the geometry pass\nlayout(location = 2) out vec4 SurfaceNormal;\n#endif\n\nstruct Camera {\n    vec3 Position, Target;\n    vec3 TopLeft, TopRight, BottomLeft, BottomRight;\n};\n\nstruct Ray {\n    vec3 Origin, Direction;\n};\n\nuniform float EPSILON;\nuniform float MAX_DISTANCE;\nuniform int MAX_MARCHING_STEPS;\n// Primary rays step this many times the distance while that stays safe, 1 is plain sphere tracing\nuniform float MarchRelaxation;\n\nuniform bool ShadowsEnabled;\nuniform float ShadowStrength;\n// Shadow rays give up as lit after SHADOW_STEPS steps or SHADOW_DISTANCE, or once they leave SceneMin to SceneMax when SceneBounded is set\nuniform int SHADOW_STEPS;\nuniform float SHADOW_DISTANCE;\nuniform bool SceneBounded;\nuniform vec3 SceneMin, SceneMax;\n// How sharp the penumbra is, 0 gives hard shadows\nuniform float ShadowSoftness;\n// Baked distance along the light to the first hit, looked up instead of marching a shadow ray where the map covers.\n// It only knows whether the light is blocked, so with a soft penumbra it only stands in for the ray where p is fully blocked.\n// ShadowMapTransform takes a world position to its texel in xy and its distance along the light in z\nuniform bool ShadowMapEnabled;\nuniform sampler2D ShadowMap;\nuniform mat4 ShadowMapTransform;\nuniform float ShadowMapTexel;\n// The bake pass marches one ray along the light per texel, starting from where ShadowMapInverse puts the texel\nuniform bool ShadowBake;\nuniform mat4 ShadowMapInverse;\n\nuniform float AOStrength;\n// Occlusion baked over AOVolumeMin to AOVolumeMax, looked up instead of tapping the scene where the volume covers\nuniform bool AOVolumeEnabled;\nuniform sampler3D AOVolume;\nuniform vec3 AOVolumeMin, AOVolumeMax;\n// The bake pass fills slice AOBakeSlice of a volume with AOVolumeResolution voxels\nuniform bool AOBake;\nuniform int AOBakeSlice;\nuniform vec3 AOVolumeResolution;\n\nuniform vec3 AmbientColor;\nuniform vec3 LightColor;\nuniform vec3 LightDir;\n\nuniform vec2 ScreenSize;\nuniform Camera MainCamera;\nuniform float Time;\n\n// 0 shades normally, 1 shows primary steps, 2 shadow steps and 3 SceneSDF calls, scaled so HeatmapScale is red\nuniform int DebugView;\nuniform float HeatmapScale;\n// Writes the raw counts (primary steps, shadow steps, SceneSDF calls) instead of a color, used to read them back\nuniform bool DebugRaw;\n\n// The low resolution pass writes how far the rays of each block of PrepassScale x PrepassScale pixels can skip,\n// the full resolution pass then starts marching from there\nuniform bool DepthPrepass;\nuniform bool PrepassEnabled;\nuniform int PrepassScale;\nuniform sampler2D PrepassDepth;\n\n// Depth along each ray at which last frame's closest reprojected hit landed, huge where nothing did\nuniform bool HistoryEnabled;\nuniform float HistoryBackoff;\nuniform sampler2D HistoryDepth;\n\n// Only pixels where x + y + CheckerboardParity is even get marched, the rest are filled in afterwards\nuniform bool CheckerboardEnabled;\nuniform int CheckerboardParity;\n\n// Level from 0 to 1 in thirds per QualityTileSize x QualityTileSize tile, lower levels march coarser and skip AO, the lowest skips shadows too\nuniform bool VariableRate;\nuniform int QualityTileSize;\nuniform sampler2D QualityMap;\n\n// The geometry pass only marches, and writes the march's depth, steps, Grazing and SDF calls to FragColor instead of a color.\n// The lighting pass shades from what it wrote without marching again, with neither set both happen in one pass\nuniform bool GeometryPass;\nuniform bool LightingPass;\nuniform sampler2D GBufferMarch;\nuniform sampler2D GBufferPosition;\nuniform sampler2D GBufferSurface;\n\n// The edge pass marches EdgeSamples more rays for each pixel set in EdgeMask, to blend over the one already lit\nuniform bool EdgeResample;\nuniform int EdgeSamples;\nuniform sampler2D EdgeMask;\n\n// A distance volume over SparseMin to SparseMax that only keeps its voxels near the surface. SparseIndex has an entry per 8^3 brick of\n// SparseDimensions: below SparseResident it's the brick's slot in SparseAtlas, past that it counts the whole SparseBands the brick stays\n// from the surface, doubled and plus one if inside. The atlas has SparseSlots.x by SparseSlots.y slots a layer, each a brick and the voxels\n// after it in fractions of SparseBand\nuniform usampler3D SparseIndex;\nuniform sampler3D SparseAtlas;\nuniform vec3 SparseMin, SparseMax;\nuniform ivec3 SparseDimensions;\nuniform ivec2 SparseSlots;\nuniform float SparseBand;\nuniform int SparseResident;\n\nfloat StartDepth = 0.f;\n// EPSILON, MAX_MARCHING_STEPS and ShadowsEnabled after the tile's quality level is applied\nfloat Epsilon;\nint MarchSteps;\nbool UseShadows, UseAO = true;\n\nint PrimarySteps = 0;\nint ShadowSteps = 0;\nint SDFCalls = 0;\nint Material = 0;\n// Smallest ratio of distance to the scene over distance travelled the primary ray saw, a miss that grazed a surface has a small one\nfloat Grazing = 1e10;\n\n//uniform sampler3D Model;\n\nRay CalculateRay(in vec2 fragCoord) {\n    vec2 RelScreenPos = fragCoord / ScreenSize;\n\n    vec3 TopPos = mix(MainCamera.TopLeft, MainCamera.TopRight, RelScreenPos.x);\n    vec3 BottomPos = mix(MainCamera.BottomLeft, MainCamera.BottomRight, RelScreenPos.x);\n    vec3 FinalPos = mix(TopPos, BottomPos, RelScreenPos.y);\n    return Ray(FinalPos, normalize(FinalPos-MainCamera.Position));\n}\n\n#ifndef COMPUTE_MARCH\nRay CalculateFragRay() {\n    return CalculateRay(gl_FragCoord.xy);\n}\n#endif\n\nfloat SceneSDF(in vec3 p);\n\n#ifdef SCENE_MATERIAL\n// Scenes with materials give the ID of the surface nearest to p, and the color each ID reflects\nint SceneMaterial(in vec3 p);\nvec3 MaterialColor(in int material);\n#endif\n\n// Distance from the sparse volume a scene loads with \"#pragma volume <model> [band voxels]\", points outside it get the distance at its nearest voxel\nfloat SparseDistance(in vec3 p) {\n    vec3 voxel = clamp((p - SparseMin) / (SparseMax - SparseMin) * vec3(SparseDimensions) - 0.5, vec3(0), vec3(SparseDimensions - 1));\n    ivec3 brick = ivec3(voxel) / 8;\n    uint entry = texelFetch(SparseIndex, brick, 0).r;\n    if (entry >= uint(SparseResident)) {\n        uint code = entry - uint(SparseResident);\n        return ((code & 1u) != 0u ? -1.0 : 1.0) * float(code >> 1) * SparseBand;\n    }\n    int slot = int(entry);\n    ivec3 origin = ivec3(slot % SparseSlots.x, (slot / SparseSlots.x) % SparseSlots.y, slot / (SparseSlots.x * SparseSlots.y)) * 9;\n    // The slot has the voxels after the brick too, so the hardware filter never blends in a neighbouring slot\n    vec3 texel = vec3(origin) + voxel - vec3(brick * 8) + 0.5;\n    return texture(SparseAtlas, texel / vec3(textureSize(SparseAtlas, 0))).r * SparseBand;\n}\n\n// float s = 100000;\n// if (sdBox(p - vec3(1), vec3(1)) <= EPSILON) {\n//     s = texture(Model, p * vec3(1.f/2)).r;\n// }\n// else {\n//     s = sdBox(p - vec3(1), vec3(1));\n// }\n// float f = sphereSDF(SDFRepitition(p, vec3(6,0,6)), vec3(0));\n// if (f <= EPSILON) {\n//     //f = max(f, cnoise(p+vec3(Time)));\n// }\n\n// return min(min(s, f), p.y);\n\n/*float SceneSDFAO(in vec3 p) {\n    // float s = 100000;\n    // if (sdBox(p - vec3(1), vec3(1)) <= EPSILON) {\n    //     s = texture(Model, p * vec3(1.f/2)).r;\n    // }\n    // else if (sdBox(p - vec3(1), vec3(1)) <= 0.5) {\n    //     s = sdBox(p - vec3(1), vec3(1)) + texture(Model, p * vec3(1.f/2)).r;\n    // }\n    // float f = sphereSDF(SDFRepitition(p, vec3(6,0,6)), vec3(0));\n    // if (f <= EPSILON) {\n    //     //f = max(f, cnoise(p+vec3(Time)));\n    // }\n\n    // return min(min(s, f), p.y);\n    return min(sphereSDF(SDFRepitition(p, vec3(6,6,6)), vec3(0)), p.y);\n}*/\n\n#ifdef SCENE_GRADIENT\n// Generated scenes come with their gradient in xyz and the distance in w, so a normal costs one evaluation\nvec4 SceneGradient(in vec3 p);\n\nvec3 EstimateNormal(in vec3 p) {\n    SDFCalls++;\n    return normalize(SceneGradient(p).xyz);\n}\n#else\n// Four taps on the corners of a tetrahedron, instead of six on the axes\nvec3 EstimateNormal(in vec3 p) {\n    vec2 k = vec2(1, -1);\n    SDFCalls += 4;\n\n    vec3 normal = k.xyy * SceneSDF(p + k.xyy * Epsilon) + k.yyx * SceneSDF(p + k.yyx * Epsilon)\n                + k.yxy * SceneSDF(p + k.yxy * Epsilon) + k.xxx * SceneSDF(p + k.xxx * Epsilon);\n\n    return normalize(normal);\n}\n#endif\n\nstruct MarchInfo {\n    bool Hit;\n    float Depth, MinDistance;\n    vec3 Position, Normal;\n    int Steps;\n};\n\nMarchInfo March(in Ray ray) {\n    float depth = StartDepth;\n    float dist, minDist = MAX_DISTANCE;\n    // Over-relaxed steps are only safe while each new sphere overlaps the last one, and landing inside the surface would put the hit in the wrong place.\n    // Either way the step is undone and the ray carries on unrelaxed\n    float relaxation = MarchRelaxation;\n    float stepLength = 0.f, lastDist = 0.f;\n    int i = 0;\n    for (; i < MarchSteps; i++) {\n        dist = SceneSDF(ray.Origin + (ray.Direction * depth));\n        SDFCalls++;\n        if (relaxation > 1.f && (dist < 0.f || dist + lastDist < stepLength)) {\n            depth -= stepLength - lastDist;\n            relaxation = 1.f;\n            continue;\n        }\n        minDist = min(dist, minDist);\n        Grazing = min(Grazing, dist / max(depth, Epsilon));\n        if (dist < Epsilon) {\n            if (dist < 0) {\n                depth += dist; depth += dist;\n            }\n            return MarchInfo(true, depth, dist, ray.Origin + (ray.Direction * depth), EstimateNormal(ray.Origin + (ray.Direction * depth)), i);\n        }\n        // Only the unrelaxed step is known to be empty, so that's what has to reach MAX_DISTANCE\n        if (depth + dist >= MAX_DISTANCE) {\n            depth += dist;\n            return MarchInfo(false, depth, minDist, ray.Origin + (ray.Direction * depth), vec3(0), i);\n        }\n        lastDist = dist;\n        stepLength = dist * relaxation;\n        depth += stepLength;\n    }\n    return MarchInfo(false, depth, minDist, ray.Origin + (ray.Direction * depth), vec3(0), i);\n}\n\n// Marches a cone that holds the rays of every pixel this fragment covers and returns a depth all of them can start from\nfloat ConeMarch(in Ray ray) {\n    // Rays drift apart by at most half the fragment's diagonal on the near plane, growing linearly with the distance from the camera\n    vec2 pixel = vec2(distance(MainCamera.TopLeft, MainCamera.TopRight), distance(MainCamera.TopLeft, MainCamera.BottomLeft)) / ScreenSize;\n    float near = distance(MainCamera.Position, ray.Origin);\n    float spread = 0.5 * length(pixel) / dot(ray.Origin - MainCamera.Position, normalize(MainCamera.Target - MainCamera.Position));\n\n    float depth = 0.f;\n    for (int i = 0; i < MarchSteps && depth < MAX_DISTANCE; i++) {\n        float radius = (near + depth) * spread;\n        float dist = SceneSDF(ray.Origin + ray.Direction * depth);\n        if (dist < radius + Epsilon) {\n            break;\n        }\n        // The cone keeps widening over the step, so it has to stop short of the sphere's edge\n        depth += (dist - radius) / (1.0 + spread);\n    }\n    return max(depth - (near + depth) * spread, 0.f);\n}\n\n// How far along a ray towards the light something could still block it\nfloat ShadowRange(in Ray ray) {\n    float range = SHADOW_DISTANCE;\n    if (SceneBounded) {\n        vec3 direction = mix(ray.Direction, vec3(1e-6), equal(ray.Direction, vec3(0)));\n        vec3 exit = max((SceneMin - ray.Origin) / direction, (SceneMax - ray.Origin) / direction);\n        range = min(range, min(exit.x, min(exit.y, exit.z)));\n    }\n    return range;\n}\n\n// Returns how much light gets through, from 0 to 1. The closest the ray comes to a surface relative to how far along it is\n// gives the penumbra, so it costs nothing over a hard shadow\nfloat Shadow(in Ray ray) {\n    float range = ShadowRange(ray);\n    float light = 1.0;\n    float t = Epsilon;\n    for (int i = 0; i < SHADOW_STEPS && t < range; i++) {\n        float h = SceneSDF(ray.Origin + ray.Direction*t);\n        ShadowSteps++;\n        SDFCalls++;\n        if (ShadowSoftness > 0) {\n            light = min(light, ShadowSoftness * h / t);\n        }\n        if (h < Epsilon || light < 0.01)\n            return 0.0;\n        t += h;\n    }\n    return light;\n}\n\n// Where along the light the ray through a texel of the shadow map first hits something, measured the same way as ShadowMapTransform's z\nfloat BakeShadowDepth(in vec2 uv) {\n    vec3 origin = (ShadowMapInverse * vec4(uv, 0, 1)).xyz;\n    vec3 direction = normalize(LightDir);\n    vec3 safeDirection = mix(direction, vec3(1e-6), equal(direction, vec3(0)));\n    vec3 t0 = (SceneMin - origin) / safeDirection, t1 = (SceneMax - origin) / safeDirection;\n    vec3 entry = min(t0, t1), exit = max(t0, t1);\n    float t = max(entry.x, max(entry.y, entry.z));\n    float far = min(exit.x, min(exit.y, exit.z));\n    for (int i = 0; i < MAX_MARCHING_STEPS && t < far; i++) {\n        float dist = SceneSDF(origin + direction * t);\n        if (dist < Epsilon) {\n            return t;\n        }\n        t += dist;\n    }\n    return 1e30;\n}\n\n// How much light reaches p going by the shadow map, with the four nearest texels blended. -1 where the map doesn't cover p\nfloat ShadowMapLight(in vec3 p, in vec3 normal) {\n    // Moving a texel off the surface keeps it from shadowing itself\n    vec3 light = (ShadowMapTransform * vec4(p + normal * ShadowMapTexel, 1)).xyz;\n    if (any(lessThan(light.xy, vec2(0))) || any(greaterThan(light.xy, vec2(1)))) {\n        return -1.0;\n    }\n    ivec2 size = textureSize(ShadowMap, 0);\n    vec2 texel = light.xy * vec2(size) - 0.5;\n    ivec2 base = ivec2(floor(texel));\n    vec2 f = texel - vec2(base);\n    float lit[4];\n    for (int i = 0; i < 4; i++) {\n        ivec2 tap = clamp(base + ivec2(i & 1, i >> 1), ivec2(0), size - 1);\n        lit[i] = light.z <= texelFetch(ShadowMap, tap, 0).r + ShadowMapTexel ? 1.0 : 0.0;\n    }\n    return mix(mix(lit[0], lit[1], f.x), mix(lit[2], lit[3], f.x), f.y);\n}\n\n// Weighted sum of how far taps along rd from ro end up inside the scene\nfloat OcclusionTaps(vec3 ro, vec3 rd) {\n    vec4 totao = vec4(0.0);\n    float sca = 1.0;\n\n    for (int aoi = 0; aoi < 5; aoi++) {\n        float hr = 0.01 + 0.02 * float(aoi * aoi);\n        vec3 aopos = ro + rd * hr;\n        float dd = SceneSDF(aopos);\n        SDFCalls++;\n        float ao = clamp(-(dd - hr), 0.0, 1.0);\n        totao += ao * sca * vec4(1.0, 1.0, 1.0, 1.0);\n        sca *= 0.75;\n    }\n    \n    return totao.w;\n}\n\nfloat genAmbientOcclusion(vec3 ro, vec3 rd) {\n    return 1.0 - clamp(AOStrength * OcclusionTaps(ro, rd), 0.0, 1.0);\n}\n\n// The occlusion of the surface nearest to p, which is what each voxel of the AO volume holds\nfloat BakeOcclusion(in vec3 p) {\n    float dist = SceneSDF(p);\n    // Lookups only blend voxels within one of the surface, past that and the taps' reach there's nothing to store\n    float voxel = length((AOVolumeMax - AOVolumeMin) / AOVolumeResolution);\n    if (dist > max(0.5, 2.0 * voxel)) {\n        return 0.0;\n    }\n    vec3 normal = EstimateNormal(p);\n    return OcclusionTaps(p - normal * dist + normal * Epsilon, normal);\n}\n\n// Occlusion from the AO volume, -1 where it doesn't cover p\nfloat VolumeOcclusion(in vec3 p) {\n    vec3 uvw = (p - AOVolumeMin) / (AOVolumeMax - AOVolumeMin);\n    if (any(lessThan(uvw, vec3(0))) || any(greaterThan(uvw, vec3(1)))) {\n        return -1.0;\n    }\n    return texture(AOVolume, uvw).r;\n}\n\nvec3 Shade(in Ray ray, in MarchInfo info) {\n    if (info.Hit) {\n        float shadow = 0.f;\n        // Surfaces facing away from the light are unlit either way\n        float diffuse = dot(info.Normal, normalize(-LightDir));\n        if (UseShadows && diffuse > 0.f) {\n            float light = ShadowMapEnabled ? ShadowMapLight(info.Position, info.Normal) : -1.0;\n            // Blocked rays give no light with or without a penumbra, but only the ray knows how close it came to blocking\n            if (light < 0.0 || (ShadowSoftness > 0 && light > 0.0)) {\n                light = Shadow(Ray(info.Position + info.Normal * Epsilon*2, normalize(-LightDir)));\n            }\n            shadow = 1.f-light;\n        }\n        \n        vec3 ret = LightColor * max(diffuse, 0.f);\n#ifdef SCENE_MATERIAL\n        ret *= MaterialColor(Material);\n#endif\n        ret -= vec3(shadow * ShadowStrength) * ret;\n        ret += AmbientColor * (vec3(1)-ret);\n\n        if (UseAO) {\n            float occlusion = AOVolumeEnabled ? VolumeOcclusion(info.Position) : -1.0;\n            if (occlusion < 0.0) {\n                ret *= genAmbientOcclusion(info.Position + info.Normal * Epsilon, info.Normal);\n            }\n            else {\n                ret *= 1.0 - clamp(AOStrength * occlusion, 0.0, 1.0);\n            }\n        }\n        return mix(ret * vec3(1.f), AmbientColor, distance(ray.Origin, info.Position)/MAX_DISTANCE);\n    }\n    return AmbientColor;\n}\n\n#ifndef COMPUTE_MARCH\n// The average of EdgeSamples more rays spread over the pixel, after the one through its centre\nvec3 Resample() {\n    vec3 color = vec3(0);\n    for (int i = 1; i <= EdgeSamples; i++) {\n        // R2 sequence offsets, the same ones the accumulated samples use\n        vec2 offset = fract(0.5 + float(i) * vec2(0.7548776662466927, 0.5698402909980532)) - 0.5;\n        Ray ray = CalculateRay(gl_FragCoord.xy + offset);\n        MarchInfo info = March(ray);\n#ifdef SCENE_MATERIAL\n        if (info.Hit) {\n            Material = SceneMaterial(info.Position);\n        }\n#endif\n        color += Shade(ray, info);\n    }\n    return color / float(EdgeSamples);\n}\n\nvoid SetDiffuse(in vec3 col) {\n\n}\n\nvec3 Heatmap(float t) {\n    t = clamp(t, 0.0, 1.0);\n    return clamp(vec3(1.5) - abs(4.0 * t - vec3(3.0, 2.0, 1.0)), 0.0, 1.0);\n}\n\nvoid main() {\n    Ray CamRay = CalculateFragRay();\n\n    Epsilon = EPSILON;\n    MarchSteps = MAX_MARCHING_STEPS;\n    UseShadows = ShadowsEnabled;\n    if (VariableRate && !DepthPrepass && !ShadowBake && !AOBake) {\n        // Each level below full doubles the epsilon and takes a quarter of the steps away\n        int level = int(texelFetch(QualityMap, ivec2(gl_FragCoord.xy) / QualityTileSize, 0).r * 3.0 + 0.5);\n        Epsilon *= exp2(float(3 - level));\n        MarchSteps = MAX_MARCHING_STEPS * (level + 1) / 4;\n        UseAO = level >= 2;\n        UseShadows = UseShadows && level >= 1;\n    }\n\n    if (ShadowBake) {\n        FragColor = vec4(BakeShadowDepth(gl_FragCoord.xy / ScreenSize), 0, 0, 1);\n        return;\n    }\n    if (AOBake) {\n        vec3 voxel = vec3(gl_FragCoord.xy, float(AOBakeSlice) + 0.5) / AOVolumeResolution;\n        FragColor = vec4(BakeOcclusion(mix(AOVolumeMin, AOVolumeMax, voxel)), 0, 0, 1);\n        return;\n    }\n    if (DepthPrepass) {\n        FragColor = vec4(ConeMarch(CamRay), 0, 0, 1);\n        return;\n    }\n    if (EdgeResample) {\n        if (texelFetch(EdgeMask, ivec2(gl_FragCoord.xy), 0).r < 0.5) {\n            discard;\n        }\n        // Blended so the pixel ends up as the average of all its samples\n        FragColor = vec4(Resample(), float(EdgeSamples) / float(EdgeSamples + 1));\n        return;\n    }\n    if (CheckerboardEnabled && ((int(gl_FragCoord.x) + int(gl_FragCoord.y) + CheckerboardParity) & 1) != 0) {\n        discard;\n    }\n\n    // A depth of -1 marks a camera that's inside the surface\n    MarchInfo info;\n    bool inside;\n    if (LightingPass) {\n        ivec2 pixel = ivec2(gl_FragCoord.xy);\n        vec4 march = texelFetch(GBufferMarch, pixel, 0);\n        vec4 position = texelFetch(GBufferPosition, pixel, 0);\n        vec4 surface = texelFetch(GBufferSurface, pixel, 0);\n        inside = march.x < 0;\n        // The G-buffer keeps how closely the ray grazed the scene instead of its closest distance, nothing is shaded from either\n        info = MarchInfo(position.w != 0, march.x, 0.0, position.xyz, surface.xyz, int(march.y));\n        SDFCalls = int(march.w);\n        Material = int(surface.w);\n    }\n    else {\n        if (PrepassEnabled) {\n            StartDepth = texelFetch(PrepassDepth, ivec2(gl_FragCoord.xy) / PrepassScale, 0).r;\n        }\n        if (HistoryEnabled) {\n            // Something may have moved in front of last frame's hit, so the start is only trusted if it's still outside the surface\n            float history = texelFetch(HistoryDepth, ivec2(gl_FragCoord.xy), 0).r * (1.0 - HistoryBackoff);\n            if (history < MAX_DISTANCE && history > StartDepth) {\n                SDFCalls++;\n                if (SceneSDF(CamRay.Origin + CamRay.Direction * history) > Epsilon) {\n                    StartDepth = history;\n                }\n            }\n        }\n\n        SDFCalls++;\n        inside = SceneSDF(CamRay.Origin) < Epsilon;\n        if (inside) {\n            info = MarchInfo(false, -1.0, 0.0, CamRay.Origin, vec3(0), 0);\n        }\n        else {\n            info = March(CamRay);\n        }\n#ifdef SCENE_MATERIAL\n        if (info.Hit) {\n            Material = SceneMaterial(info.Position);\n        }\n#endif\n    }\n\n    PrimarySteps = info.Steps;\n    HitPosition = vec4(info.Position, info.Hit ? 1 : 0);\n    if (GeometryPass) {\n        FragColor = vec4(info.Depth, info.Steps, Grazing, SDFCalls);\n        SurfaceNormal = vec4(info.Normal, Material);\n        return;\n    }\n\n    if (inside) {\n        HitPosition = vec4(0);\n        FragColor = vec4(0,0,0,1);\n    }\n    else {\n        FragColor = vec4(Shade(CamRay, info), 1.f);\n    }\n\n    if (DebugRaw) {\n        FragColor = vec4(PrimarySteps, ShadowSteps, SDFCalls, 1);\n    }\n    else if (DebugView == 1) {\n        FragColor = vec4(Heatmap(PrimarySteps / HeatmapScale), 1);\n    }\n    else if (DebugView == 2) {\n        FragColor = vec4(Heatmap(ShadowSteps / HeatmapScale), 1);\n    }\n    else if (DebugView == 3) {\n        FragColor = vec4(Heatmap(SDFCalls / HeatmapScale), 1);\n    }\n}\n#endif";
 std::string VertexShader = "#version 330 core\nlayout (location = 0) in vec3 aPos;\n\nvoid main() {\n    gl_Position = vec4(aPos, 1.0);\n}";
-std::string DefaultShader = "float SceneSDF(in vec3 p) {\n    float sphere = distance(p + vec3(sin(p.x*20)*0.01), vec3(0, 1, 0)) - 1;\n    float plane = p.y;\n\n    return min(sphere, plane);\n}";
+std::string DefaultShader = "#pragma bounds -100000 -1 -100000 100000 2.1 100000\n\nfloat SceneSDF(in vec3 p) {\n    float sphere = distance(p + vec3(sin(p.x*20)*0.01), vec3(0, 1, 0)) - 1;\n    float plane = p.y;\n\n    return min(sphere, plane);\n}";
 
 // F E A R L E S S C O N C U R R E N C Y
 // G L O B A L V A R I A B L E S
@@ -26,20 +44,89 @@ namespace globals {
 
 	float MarchDistance = 200.f;
 	int MarchSteps = 1024;
+	//Set per scene with "#pragma relaxation <factor>" in shader.fs, scenes without it get DefaultRelaxation, which --relaxation sets
+	float MarchRelaxation = 1.f;
+	float DefaultRelaxation = 1.f;
+
+	//Cone marches a 1/PrepassScale resolution image first so the full resolution rays can skip the empty space it found
+	bool PrepassEnabled = true;
+	int PrepassScale = 4;
+
+	//Starts rays just short of where last frame's hits reproject to, backed off by this fraction of the depth
+	bool HistoryEnabled = true;
+	float HistoryBackoff = 0.05f;
+	//Scenes that animate with Time can't reuse last frame's hits
+	bool SceneUsesTime = false;
+
+	//Marches every other pixel in a checkerboard that flips each frame, the others come from the last frame or their neighbours
+	bool CheckerboardEnabled = false;
+
+	//Marches the frame with persistent compute threads instead of the fragment passes, only where OpenGL 4.3 is there.
+	//It always marches every pixel, so the prepass, last frame's depths, checkerboard and variable rate are fragment path only
+	bool ComputeMarching = false;
+	bool ComputeSupported = false;
+
+	//Marches each tile of the screen coarser or finer, 0 is off, 1 foveated around the middle and 2 from last frame's edges
+	int VariableRate = 0;
 
 	bool ShadowsEnabled = true;
 	float ShadowStrength = 1.f;
+	//Shadow rays stop after this many steps or this far, whichever comes first, and earlier still once they leave the scene's bounds
+	int ShadowSteps = 128;
+	float ShadowDistance = 50.f;
+	float ShadowSoftness = 16.f;
+	//Set per scene with "#pragma bounds <min x y z> <max x y z>" in shader.fs, everything that can cast a shadow has to be inside
+	bool SceneBounded = false;
+	glm::vec3 SceneMin = glm::vec3(0.f), SceneMax = glm::vec3(0.f);
+	//Bakes a shadow map whenever the light changes, only for bounded scenes that don't use Time.
+	//With a soft penumbra the map only saves the rays of fully shadowed points, the rest still march for their penumbra
+	bool ShadowMapEnabled = true;
+	float ShadowMapProgress = 0.f;
+
 	float AOStrength = 1.f;
+	//Bakes AO into a volume once per scene, with the same conditions as the shadow map
+	bool AOVolumeEnabled = true;
+	float AOVolumeProgress = 0.f;
+	//Both bakes cover the scene bounds within this distance of the origin
+	float BakeExtent = 20.f;
+	//How much memory the AO volume may take, it gets as many voxels as fit
+	float AOVolumeMB = 8.f;
+	//Set per scene with "#pragma volume <model> [band voxels]" in shader.fs, SparseDistance() then samples a sparse volume of the model
+	std::string SceneVolume;
+	float SceneVolumeBand = marcher::SparseVolume::DefaultBand;
 	glm::vec3 AmbientColor = glm::vec3(0.05f);
 	glm::vec3 LightColor = glm::vec3(1.f);
 	glm::vec3 LightDirection = glm::vec3(-1.f);
 
+	//Adds a jittered sample per pixel each frame while the view holds still, and shows the running average
 	bool AAEnabled = true;
+	int AASamples = 0;
+	//While the view moves, only the pixels on edges get EdgeSamples more rays. EdgeResampled is the fraction of pixels that did
+	bool EdgeAAEnabled = true;
+	int EdgeSamples = 4;
+	float EdgeResampled = 0.f;
+
+	int DebugView = 0;
+	float HeatmapScale = 256.f;
+	//Counts read back from the pixel under the cursor while a debug view is up
+	bool ProbeValid = false;
+	glm::ivec3 ProbeCounts = glm::ivec3(0);
 
 	bool running = true;
 	bool VSync = true;
 	float MainFPS = 0.f;
 	float MainMS = 0.f;
+	float GPUMS = 0.f;
+	//Set while nothing has changed and the last frame is being shown again
+	bool Idle = false;
+
+	//Renders at ResolutionScale times the window size, with the scale picked each frame to keep the GPU time under FrameBudget MS
+	bool DynamicResolution = false;
+	float FrameBudget = 16.f;
+	float ResolutionScale = 1.f;
+	const int ScaleHistorySize = 120;
+	float ScaleHistory[ScaleHistorySize] = {};
+	int ScaleHistoryOffset = 0;
 }
 
 void UtiltiyWindow(sf::Window *mainWindow) {
@@ -75,7 +162,18 @@ void UtiltiyWindow(sf::Window *mainWindow) {
 		ImGui::Text("Performance");
 		ImGui::Text(("FPS: " + std::to_string(globals::MainFPS)).c_str());
 		ImGui::Text(("MS: " + std::to_string(globals::MainMS)).c_str());
+		ImGui::Text(("GPU MS: " + std::to_string(globals::GPUMS)).c_str());
+		if (globals::Idle)
+			ImGui::Text("Idle, nothing changed");
 		ImGui::Checkbox("VSync", &globals::VSync);
+		ImGui::Checkbox("Dynamic Resolution", &globals::DynamicResolution);
+		if (globals::DynamicResolution) {
+			ImGui::PushItemWidth(-75);
+			ImGui::SliderFloat("Budget MS", &globals::FrameBudget, 2.f, 50.f, "%.1f");
+			ImGui::PopItemWidth();
+			ImGui::Text("Scale: %.2f", globals::ResolutionScale);
+			ImGui::PlotLines("##Scale", globals::ScaleHistory, globals::ScaleHistorySize, globals::ScaleHistoryOffset, nullptr, 0.f, 1.f, ImVec2(-1, 40));
+		}
 		ImGui::Text("Controls:\nF1 - Reload Shader\nF - Toggle Mouselook\nW,A,S,D,LCtrl,\nLShift & Space - Movement");
 
 		if (ImGui::CollapsingHeader("Meta")) {ImGui::PushItemWidth(-100);
@@ -98,6 +196,42 @@ void UtiltiyWindow(sf::Window *mainWindow) {
 			ImGui::Spacing();
 			ImGui::SliderInt("Marching Steps", &globals::MarchSteps, 1, 2048);
 			ImGui::Spacing();
+			ImGui::SliderFloat("Relaxation", &globals::MarchRelaxation, 1.f, 1.9f, "%.2f");
+			ImGui::Spacing();
+			ImGui::Checkbox("Depth Prepass", &globals::PrepassEnabled);
+			if (globals::PrepassEnabled) {
+				int scale = globals::PrepassScale == 8 ? 1 : 0;
+				const char* scales[] = { "1/4", "1/8" };
+				ImGui::Combo("Prepass Scale", &scale, scales, 2);
+				globals::PrepassScale = scale == 1 ? 8 : 4;
+			}
+			ImGui::Spacing();
+			ImGui::Checkbox("Checkerboard", &globals::CheckerboardEnabled);
+			ImGui::Spacing();
+			if (globals::ComputeSupported)
+				ImGui::Checkbox("Compute Marching", &globals::ComputeMarching);
+			else
+				ImGui::Text("Compute marching needs OpenGL 4.3");
+			ImGui::Spacing();
+			const char* rates[] = { "Off", "Foveated", "Edges" };
+			ImGui::Combo("Variable Rate", &globals::VariableRate, rates, 3);
+			ImGui::Spacing();
+			ImGui::Checkbox("Accumulate AA", &globals::AAEnabled);
+			if (globals::AAEnabled)
+				ImGui::Text("Samples: %d", globals::AASamples);
+			ImGui::Checkbox("Edge AA", &globals::EdgeAAEnabled);
+			if (globals::EdgeAAEnabled) {
+				ImGui::SliderInt("Edge Samples", &globals::EdgeSamples, 1, 16);
+				ImGui::Text("Resampled: %.1f%%", globals::EdgeResampled * 100.f);
+			}
+			ImGui::Spacing();
+			ImGui::Checkbox("Reuse Last Frame", &globals::HistoryEnabled);
+			if (globals::HistoryEnabled) {
+				ImGui::SliderFloat("Back Off", &globals::HistoryBackoff, 0.f, 0.5f, "%.3f");
+				if (globals::SceneUsesTime)
+					ImGui::Text("Off, the scene uses Time");
+			}
+			ImGui::Spacing();
 			if (ImGui::CollapsingHeader("Lighting")) {
 				ImGui::Checkbox("Enable Shadows", &globals::ShadowsEnabled);
 				ImGui::Spacing();
@@ -105,6 +239,28 @@ void UtiltiyWindow(sf::Window *mainWindow) {
 				ImGui::Spacing();
 				ImGui::SliderFloat("Shadow Strength", &globals::ShadowStrength, 0.f, 1.f, "%.2f");
 				ImGui::Spacing();
+				ImGui::SliderFloat("Softness", &globals::ShadowSoftness, 0.f, 64.f, "%.1f");
+				ImGui::Spacing();
+				ImGui::SliderInt("Shadow Steps", &globals::ShadowSteps, 1, 512);
+				ImGui::Spacing();
+				ImGui::SliderFloat("Shadow Distance", &globals::ShadowDistance, 1.f, 2000.f, "%.1f");
+				if (globals::SceneBounded)
+					ImGui::Text("Clipped to the scene bounds");
+				ImGui::Spacing();
+				ImGui::Checkbox("Bake Shadows", &globals::ShadowMapEnabled);
+				ImGui::Checkbox("Bake AO", &globals::AOVolumeEnabled);
+				if (globals::ShadowMapEnabled || globals::AOVolumeEnabled) {
+					ImGui::SliderFloat("Bake Extent", &globals::BakeExtent, 1.f, 200.f, "%.1f");
+					if (globals::AOVolumeEnabled)
+						ImGui::SliderFloat("AO Volume MB", &globals::AOVolumeMB, 1.f, 256.f, "%.0f");
+					if (!globals::SceneBounded || globals::SceneUsesTime)
+						ImGui::Text("Off, needs a static scene with bounds");
+					else if (globals::ShadowMapEnabled && globals::ShadowMapProgress < 1.f)
+						ImGui::Text("Baking shadows: %.0f%%", globals::ShadowMapProgress * 100.f);
+					else if (globals::AOVolumeEnabled && globals::AOVolumeProgress < 1.f)
+						ImGui::Text("Baking AO: %.0f%%", globals::AOVolumeProgress * 100.f);
+				}
+				ImGui::Spacing();
 				ImGui::ColorPicker3("Ambient Light", &globals::AmbientColor[0]);
 				ImGui::Spacing();
 				ImGui::ColorPicker3("Light Color", &globals::LightColor[0]);
@@ -116,6 +272,22 @@ void UtiltiyWindow(sf::Window *mainWindow) {
 			}
 		}
 
+		if (ImGui::CollapsingHeader("Debug")) {
+			const char* views[] = { "Shaded", "Primary Steps", "Shadow Steps", "SDF Calls" };
+			ImGui::Combo("View", &globals::DebugView, views, 4);
+			ImGui::Spacing();
+			ImGui::SliderFloat("Heat Scale", &globals::HeatmapScale, 1.f, 4096.f, "%.0f", 3.f);
+			if (globals::DebugView != 0) {
+				ImGui::Spacing();
+				if (globals::ProbeValid) {
+					ImGui::Text("Under Cursor\nPrimary Steps: %d\nShadow Steps: %d\nSDF Calls: %d", globals::ProbeCounts.x, globals::ProbeCounts.y, globals::ProbeCounts.z);
+				}
+				else {
+					ImGui::Text("Under Cursor\n-");
+				}
+			}
+		}
+
 		ImGui::PopItemWidth();
 		ImGui::End();
 
@@ -136,53 +308,177 @@ bool isFile(const std::string& name) {
 
 const std::string fileName = "shader.fs";
 
+//Picks up the settings a scene asks for with pragmas, GLSL ignores pragmas it doesn't know
+void ApplyScenePragmas(const std::string& line) {
+	const std::string relaxation = "#pragma relaxation ";
+	if (line.compare(0, relaxation.size(), relaxation) == 0) {
+		float factor;
+		if (sscanf(line.c_str() + relaxation.size(), "%f", &factor) == 1)
+			globals::MarchRelaxation = glm::clamp(factor, 1.f, 1.9f);
+	}
+	const std::string bounds = "#pragma bounds ";
+	if (line.compare(0, bounds.size(), bounds) == 0) {
+		glm::vec3 min, max;
+		if (sscanf(line.c_str() + bounds.size(), "%f %f %f %f %f %f", &min.x, &min.y, &min.z, &max.x, &max.y, &max.z) == 6) {
+			globals::SceneMin = glm::min(min, max);
+			globals::SceneMax = glm::max(min, max);
+			globals::SceneBounded = true;
+		}
+	}
+	const std::string volume = "#pragma volume ";
+	if (line.compare(0, volume.size(), volume) == 0) {
+		char model[256];
+		float band = marcher::SparseVolume::DefaultBand;
+		if (sscanf(line.c_str() + volume.size(), "%255s %f", model, &band) >= 1 && band > 0.f) {
+			globals::SceneVolume = model;
+			globals::SceneVolumeBand = band;
+		}
+	}
+}
+
 std::string LoadShader() {
+	//Nothing carries over from the last scene's pragmas
+	globals::SceneBounded = false;
+	globals::MarchRelaxation = globals::DefaultRelaxation;
+	globals::SceneVolume.clear();
 	if (isFile(fileName)) {
 		std::string line;
 		std::string content;
 		std::ifstream myfile(fileName, std::ifstream::in);
 
-		while (std::getline(myfile, line)) { content.append(line + "\n"); }
+		while (std::getline(myfile, line)) {
+			ApplyScenePragmas(line);
+			content.append(line + "\n");
+		}
 		myfile.close();
-		return HeaderFS + "\n" + content;
+		globals::SceneUsesTime = content.find("Time") != std::string::npos;
+		//Scenes generated along with their gradient get their normals from it, and scenes with materials get colored by them.
+		//The defines have to come after #version
+		std::string header = HeaderFS;
+		if (content.find("SceneGradient") != std::string::npos)
+			header.insert(header.find('\n') + 1, "#define SCENE_GRADIENT\n");
+		if (content.find("SceneMaterial") != std::string::npos)
+			header.insert(header.find('\n') + 1, "#define SCENE_MATERIAL\n");
+		return header + "\n" + content;
 	}
 	else {
 		std::ofstream mfile(fileName, std::ofstream::out);
 		mfile << DefaultShader;
 		mfile.close();
+		std::istringstream defaultShader(DefaultShader);
+		std::string line;
+		while (std::getline(defaultShader, line)) {
+			ApplyScenePragmas(line);
+		}
 		return HeaderFS + "\n" + DefaultShader;
 	}
 }
 
-int main() {
-	sf::ContextSettings settings;
-	settings.depthBits = 24;
-	settings.stencilBits = 8;
-	settings.majorVersion = 4;
-	settings.minorVersion = 3;
+marcher::cpu::RenderSettings CurrentRenderSettings() {
+	marcher::cpu::RenderSettings settings;
+	settings.Epsilon = globals::Epsilon;
+	settings.MaxDistance = globals::MarchDistance;
+	settings.MaxSteps = globals::MarchSteps;
+	settings.MarchRelaxation = globals::MarchRelaxation;
+	settings.ShadowsEnabled = globals::ShadowsEnabled;
+	settings.ShadowStrength = globals::ShadowStrength;
+	settings.ShadowSteps = globals::ShadowSteps;
+	settings.ShadowDistance = globals::ShadowDistance;
+	settings.ShadowSoftness = globals::ShadowSoftness;
+	settings.SceneBounded = globals::SceneBounded;
+	settings.SceneMin = globals::SceneMin;
+	settings.SceneMax = globals::SceneMax;
+	settings.AOStrength = globals::AOStrength;
+	settings.AmbientColor = globals::AmbientColor;
+	settings.LightColor = globals::LightColor;
+	settings.LightDir = globals::LightDirection;
+	return settings;
+}
 
-	sf::Window window(sf::VideoMode(1280, 720), "Marchtool", sf::Style::Default);
-	//window.setFramerateLimit(120);
+//Hashes what decides a frame's pixels besides the main shader's uniforms: the sizes, the passes that run and where the debug probe is
+unsigned long long HashFrameState(unsigned long long uniformHash, glm::ivec2 windowSize, glm::ivec2 renderSize, glm::ivec2 mouse) {
+	int passes[] = { globals::PrepassEnabled, globals::PrepassScale, globals::HistoryEnabled, globals::CheckerboardEnabled, globals::VariableRate,
+		globals::ShadowMapEnabled, globals::AOVolumeEnabled, globals::DynamicResolution, globals::EdgeAAEnabled, globals::EdgeSamples, globals::ComputeMarching };
+	float settings[] = { globals::HistoryBackoff, globals::BakeExtent, globals::AOVolumeMB };
+	unsigned long long hash = marcher::HashValue(windowSize, uniformHash);
+	hash = marcher::HashValue(renderSize, hash);
+	hash = marcher::HashValue(passes, hash);
+	hash = marcher::HashValue(settings, hash);
+	if (globals::DebugView != 0)
+		hash = marcher::HashValue(mouse, hash);
+	return hash;
+}
 
-	sf::Thread UtilityThread(UtiltiyWindow, &window);
-	UtilityThread.launch();
+//Units the scene's sparse volume is bound to, past the ones the passes use
+const int SparseIndexUnit = 10, SparseAtlasUnit = 11;
 
-	int gladInitRes = gladLoadGL();
-	if (!gladInitRes) {
-		fprintf(stderr, "Unable to initialize glad\n");
-		window.close();
-		return -1;
+//Every uniform apart from the camera, ScreenSize and Time
+void SendRenderUniforms(std::shared_ptr<marcher::Shader> shader) {
+	if (globals::Epsilon <= 0) {
+		globals::Epsilon = 0.0005f;
 	}
+	shader->SendUniform("EPSILON", globals::Epsilon);
+	shader->SendUniform("MAX_DISTANCE", globals::MarchDistance);
+	shader->SendUniform("MAX_MARCHING_STEPS", globals::MarchSteps);
+	shader->SendUniform("MarchRelaxation", globals::MarchRelaxation);
+
+	shader->SendUniform("ShadowsEnabled", (int)globals::ShadowsEnabled);
+	shader->SendUniform("ShadowStrength", globals::ShadowStrength);
+	shader->SendUniform("SHADOW_STEPS", globals::ShadowSteps);
+	shader->SendUniform("SHADOW_DISTANCE", globals::ShadowDistance);
+	shader->SendUniform("ShadowSoftness", globals::ShadowSoftness);
+	shader->SendUniform("SceneBounded", (int)globals::SceneBounded);
+	shader->SendUniform("SceneMin", globals::SceneMin);
+	shader->SendUniform("SceneMax", globals::SceneMax);
+	shader->SendUniform("AOStrength", globals::AOStrength);
+	shader->SendUniform("AmbientColor", globals::AmbientColor);
+	shader->SendUniform("LightColor", globals::LightColor);
+	shader->SendUniform("LightDir", globals::LightDirection);
+
+	shader->SendUniform("DebugView", globals::DebugView);
+	shader->SendUniform("HeatmapScale", globals::HeatmapScale);
+	shader->SendUniform("DebugRaw", 0);
+	shader->SendUniform("DepthPrepass", 0);
+	shader->SendUniform("PrepassEnabled", 0);
+	shader->SendUniform("HistoryEnabled", 0);
+	shader->SendUniform("CheckerboardEnabled", 0);
+	shader->SendUniform("VariableRate", 0);
+	shader->SendUniform("ShadowMapEnabled", 0);
+	shader->SendUniform("ShadowBake", 0);
+	shader->SendUniform("AOVolumeEnabled", 0);
+	//A 3D sampler can't share unit 0 with the 2D ones even while it goes unused
+	shader->SendUniform("AOVolume", 5);
+	shader->SendUniform("SparseIndex", SparseIndexUnit);
+	shader->SendUniform("SparseAtlas", SparseAtlasUnit);
+	shader->SendUniform("AOBake", 0);
+	shader->SendUniform("GeometryPass", 0);
+	shader->SendUniform("LightingPass", 0);
+	shader->SendUniform("EdgeResample", 0);
+}
 
-	glEnable(GL_TEXTURE_3D);
-
-	printf("OpenGL version supported by this platform (%s): \n", glGetString(GL_VERSION));
+//Loads the volume the scene asks for with its pragma onto the GPU, null if it doesn't ask for one or the volume can't be loaded
+std::unique_ptr<marcher::SparseVolume> LoadSceneVolume() {
+	if (globals::SceneVolume.empty())
+		return nullptr;
+	std::unique_ptr<marcher::SparseVolume> volume(new marcher::SparseVolume());
+	if (!volume->LoadModel(globals::SceneVolume, globals::SceneVolumeBand) || !volume->Upload()) {
+		fprintf(stderr, "Unable to load %s for SparseDistance()\n", globals::SceneVolume.c_str());
+		return nullptr;
+	}
+	printf("Loaded %s with %zu of %zu bricks in the band\n", globals::SceneVolume.c_str(), volume->ResidentBricks(), volume->BrickCount());
+	return volume;
+}
 
-	std::shared_ptr<marcher::Shader> mainShader = std::unique_ptr<marcher::Shader>(new marcher::Shader());/*std::unique_ptr<marcher::Shader>(new marcher::Shader("main.vs", "main.fs"));*/
-	mainShader->AddShaderString(VertexShader, marcher::ShaderType::VERTEX_SHADER);
-	mainShader->AddShaderString(LoadShader(), marcher::ShaderType::FRAGMENT_SHADER);
-	mainShader->Compile();
+//Binds the scene's volume for SparseDistance(), scenes without one never call it
+void SendSceneVolume(std::shared_ptr<marcher::Shader> shader, marcher::SparseVolume* volume) {
+	if (!volume)
+		return;
+	volume->Bind(SparseIndexUnit, SparseAtlasUnit);
+	volume->SendUniforms(shader, SparseIndexUnit, SparseAtlasUnit);
+}
 
+//The two triangles the main shader's fragment passes are drawn with
+void CreateScreenQuad(unsigned int& VAO, unsigned int& VBO) {
 	float vertices[] = {
 		-1.f, -1.f, 0.f,
 		-1.f,  1.f, 0.f,
@@ -192,7 +488,6 @@ int main() {
 		-1.f, -1.f, 0.f
 	};
 
-	unsigned int VBO, VAO;
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
 	glBindVertexArray(VAO);
@@ -205,9 +500,421 @@ int main() {
 
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
+}
+
+//The compute marcher's program for a fragment source, null where compute shaders aren't there or it didn't build
+//The fragment passes' program for a scene's source as LoadShader() gives it
+std::shared_ptr<marcher::Shader> BuildMainShader(const std::string& source) {
+	std::shared_ptr<marcher::Shader> shader = std::make_shared<marcher::Shader>();
+	shader->AddShaderString(VertexShader, marcher::ShaderType::VERTEX_SHADER);
+	shader->AddShaderString(source, marcher::ShaderType::FRAGMENT_SHADER);
+	shader->Compile();
+	return shader;
+}
+
+std::shared_ptr<marcher::Shader> BuildComputeShader(const std::string& source) {
+	if (!marcher::ComputeMarcher::Supported())
+		return nullptr;
+	std::shared_ptr<marcher::Shader> shader = marcher::ComputeMarcher::BuildShader(source);
+	return shader->Linked() ? shader : nullptr;
+}
+
+//The view the main window starts with
+marcher::Camera StartCamera(int width, int height) {
+	marcher::Camera camera = marcher::Camera(glm::vec3(0, 0, 1), glm::vec3(0, 0, 0));
+	camera.FOV = globals::FieldOfView;
+	camera.Update((float)width / (float)height, glm::vec4(0, 0, width, height));
+	return camera;
+}
+
+sf::Uint8 ToByte(float channel) {
+	return (sf::Uint8)(glm::clamp(channel, 0.f, 1.f) * 255.f + 0.5f);
+}
+
+//Renders the start up view on the CPU and saves it, for machines without a GPU. The scene is the host side copy of DefaultShader
+int RenderHeadless(const std::string& path, int width, int height, unsigned int threads) {
+	marcher::Camera camera = StartCamera(width, height);
+
+	marcher::cpu::Renderer renderer(std::make_shared<marcher::cpu::DefaultScene>(), threads);
+	std::vector<glm::vec3> pixels;
+	renderer.Render(camera, CurrentRenderSettings(), width, height, pixels);
+
+	const marcher::cpu::RenderStats& stats = renderer.LastFrameStats();
+	printf("Rendered %dx%d on %u threads (%s) in %f MS (%f MRays/s)\n", width, height, renderer.ThreadCount(), marcher::cpu::SimdLevelName(renderer.GetSimdLevel()), stats.Seconds * 1000.f, (float)stats.Rays / stats.Seconds / 1000000.f);
+
+	sf::Image image;
+	image.create(width, height);
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			glm::vec3 col = pixels[(size_t)y * width + x];
+			image.setPixel(x, y, sf::Color(ToByte(col.r), ToByte(col.g), ToByte(col.b)));
+		}
+	}
+	if (!image.saveToFile(path)) {
+		fprintf(stderr, "Unable to save %s\n", path.c_str());
+		return -1;
+	}
+	return 0;
+}
+
+//Renders the headless view with scalar marching and every packet width this machine supports
+int RunBenchmark(int width, int height, unsigned int threads, int frames) {
+	marcher::Camera camera = StartCamera(width, height);
+
+	marcher::cpu::Renderer renderer(std::make_shared<marcher::cpu::DefaultScene>(), threads);
+	marcher::cpu::RenderSettings settings = CurrentRenderSettings();
+	std::vector<glm::vec3> pixels;
+
+	float scalarRate = 0.f;
+	for (int level = marcher::cpu::SIMD_SCALAR; level <= marcher::cpu::DetectSimdLevel(); level++) {
+		renderer.SetSimdLevel((marcher::cpu::SimdLevel)level);
+		if (renderer.GetSimdLevel() != level)
+			continue;
+
+		renderer.Render(camera, settings, width, height, pixels);
+		float seconds = 0.f;
+		for (int i = 0; i < frames; i++) {
+			renderer.Render(camera, settings, width, height, pixels);
+			seconds += renderer.LastFrameStats().Seconds;
+		}
+		float rate = (float)width * height * frames / seconds / 1000000.f;
+		if (level == marcher::cpu::SIMD_SCALAR)
+			scalarRate = rate;
+		printf("%-8s %f MS %f MRays/s %.2fx\n", marcher::cpu::SimdLevelName(renderer.GetSimdLevel()), seconds / frames * 1000.f, rate, rate / scalarRate);
+	}
+
+	const std::vector<marcher::cpu::ThreadStats>& threadStats = renderer.GetThreadStats();
+	for (size_t i = 0; i < threadStats.size(); i++) {
+		printf("Thread %2zu: %f MS busy, %f MS idle, %d tiles (%d stolen)\n", i, threadStats[i].BusySeconds * 1000.f, threadStats[i].IdleSeconds * 1000.f, threadStats[i].Tiles, threadStats[i].StolenTiles);
+	}
+	const marcher::cpu::RenderStats& stats = renderer.LastFrameStats();
+	printf("Shadow steps: %f per ray, at most %d\n", (float)(stats.Steps - stats.PrimarySteps) / stats.Rays, settings.ShadowSteps);
+
+	//Primary steps per ray for a range of relaxation factors, to pick one for a scene
+	float plainSteps = 0.f;
+	for (float relaxation = 1.f; relaxation < 1.95f; relaxation += 0.1f) {
+		settings.MarchRelaxation = relaxation;
+		renderer.Render(camera, settings, width, height, pixels);
+		float steps = (float)renderer.LastFrameStats().PrimarySteps / renderer.LastFrameStats().Rays;
+		if (relaxation == 1.f)
+			plainSteps = steps;
+		printf("Relaxation %.1f: %f primary steps per ray (%+.1f%%)\n", relaxation, steps, (steps / plainSteps - 1.f) * 100.f);
+	}
+	return 0;
+}
+
+//Times the fragment passes against the compute marcher on the start up view of shader.fs, through an offscreen context.
+//Both march and light every pixel of every frame, with none of the passes that reuse earlier frames
+int RunGpuBenchmark(int width, int height, int frames) {
+	sf::ContextSettings settings;
+	settings.majorVersion = 4;
+	settings.minorVersion = 3;
+	sf::Context context(settings, 1, 1);
+	if (!gladLoadGL()) {
+		fprintf(stderr, "Unable to initialize glad\n");
+		return -1;
+	}
+
+	std::string source = LoadShader();
+	std::shared_ptr<marcher::Shader> fragmentShader = BuildMainShader(source);
+	std::shared_ptr<marcher::Shader> computeShader = BuildComputeShader(source);
+	if (!computeShader) {
+		fprintf(stderr, "Compute marching needs OpenGL 4.3\n");
+		return -1;
+	}
+	std::unique_ptr<marcher::SparseVolume> sceneVolume = LoadSceneVolume();
+
+	unsigned int VAO, VBO;
+	CreateScreenQuad(VAO, VBO);
+	marcher::Camera camera = StartCamera(width, height);
+	marcher::RenderTarget frame({ GL_RGBA8, GL_RGBA32F });
+	marcher::GBuffer gbuffer;
+	marcher::ComputeMarcher computeMarcher;
+	marcher::GeometryState geometry = { camera.VP, camera.Position, glm::vec2(0.f), glm::ivec2(width, height), globals::Epsilon, globals::MarchDistance, globals::MarchRelaxation, globals::MarchSteps, 0 };
+
+	std::shared_ptr<marcher::Shader> shaders[] = { fragmentShader, computeShader };
+	const char* names[] = { "Fragment", "Compute" };
+	float fragmentMS = 0.f;
+	for (int path = 0; path < 2; path++) {
+		std::shared_ptr<marcher::Shader> shader = shaders[path];
+		shader->Bind();
+		camera.SendUniforms(shader);
+		shader->SendUniform("ScreenSize", glm::vec2(width, height));
+		shader->SendUniform("Time", 0.f);
+		SendRenderUniforms(shader);
+		SendSceneVolume(shader, sceneVolume.get());
+
+		//The first frame isn't timed, it's where the driver finishes building the program and the targets get allocated
+		marcher::Timer timer;
+		for (int i = 0; i <= frames; i++) {
+			if (i == 1) {
+				glFinish();
+				timer.Restart();
+			}
+			if (path == 0) {
+				glBindVertexArray(VAO);
+				gbuffer.Bind(geometry, false);
+				shader->SendUniform("GeometryPass", 1);
+				glDrawArrays(GL_TRIANGLES, 0, 6);
+				shader->SendUniform("GeometryPass", 0);
+				gbuffer.BindTextures(shader, 6);
+				shader->SendUniform("LightingPass", 1);
+				frame.Resize(width, height);
+				frame.Bind();
+				glDrawArrays(GL_TRIANGLES, 0, 6);
+				shader->SendUniform("LightingPass", 0);
+				glBindVertexArray(0);
+			}
+			else {
+				computeMarcher.Render(shader, frame, gbuffer, geometry);
+			}
+		}
+		glFinish();
+		float ms = timer.CurrentTime<float>() * 1000.f / frames;
+		if (path == 0)
+			fragmentMS = ms;
+		printf("%-8s %f MS %f MRays/s %.2fx\n", names[path], ms, (float)width * height / ms / 1000.f, fragmentMS / ms);
+	}
+
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	return 0;
+}
+
+//Renders the start up view at any size in bands of rows that go straight to the PNG, so the full image never has to fit in memory.
+//The GPU path draws shader.fs through an offscreen context, the CPU path renders the host side copy of DefaultShader
+int RenderPoster(const std::string& path, int width, int height, int samples, bool useCPU, unsigned int threads) {
+	const int bandHeight = 64;
+
+	std::unique_ptr<sf::Context> context;
+	std::shared_ptr<marcher::Shader> shader;
+	std::unique_ptr<marcher::TiledRenderer> tiledRenderer;
+	std::unique_ptr<marcher::cpu::Renderer> cpuRenderer;
+	std::unique_ptr<marcher::SparseVolume> sceneVolume;
+	if (useCPU) {
+		cpuRenderer = std::unique_ptr<marcher::cpu::Renderer>(new marcher::cpu::Renderer(std::make_shared<marcher::cpu::DefaultScene>(), threads));
+	}
+	else {
+		sf::ContextSettings settings;
+		settings.majorVersion = 4;
+		settings.minorVersion = 3;
+		context = std::unique_ptr<sf::Context>(new sf::Context(settings, 1, 1));
+		if (!gladLoadGL()) {
+			fprintf(stderr, "Unable to initialize glad\n");
+			return -1;
+		}
+
+		shader = BuildMainShader(LoadShader());
+		shader->Bind();
+		SendRenderUniforms(shader);
+		sceneVolume = LoadSceneVolume();
+		SendSceneVolume(shader, sceneVolume.get());
+		shader->SendUniform("Time", 0.f);
+		tiledRenderer = std::unique_ptr<marcher::TiledRenderer>(new marcher::TiledRenderer());
+	}
+
+	marcher::Camera camera = StartCamera(width, height);
+	marcher::cpu::RenderSettings settings = CurrentRenderSettings();
+
+	marcher::PngWriter writer;
+	if (!writer.Open(path, width, height)) {
+		return -1;
+	}
+
+	std::vector<glm::vec3> band((size_t)width * bandHeight);
+	std::vector<unsigned char> rgb((size_t)width * bandHeight * 3);
+	marcher::Timer timer;
+	for (int y = 0; y < height; y += bandHeight) {
+		int rows = glm::min(bandHeight, height - y);
+		if (useCPU) {
+			marcher::cpu::Tile region = { 0, y, width, rows };
+			cpuRenderer->RenderRegion(camera, settings, width, height, region, &band[0], samples);
+		}
+		else {
+			tiledRenderer->RenderRegion(shader, camera, width, height, glm::ivec4(0, y, width, rows), &band[0], samples);
+		}
+
+		for (size_t i = 0; i < (size_t)width * rows; i++) {
+			rgb[i * 3] = ToByte(band[i].r);
+			rgb[i * 3 + 1] = ToByte(band[i].g);
+			rgb[i * 3 + 2] = ToByte(band[i].b);
+		}
+		writer.WriteRows(&rgb[0], rows);
+		printf("\r%d/%d rows", y + rows, height);
+	}
+	printf("\nRendered %dx%d at %d spp in %f S\n", width, height, samples, timer.CurrentTime<float>());
+
+	if (!writer.Close()) {
+		fprintf(stderr, "Unable to save %s\n", path.c_str());
+		return -1;
+	}
+	return 0;
+}
+
+//Builds the sparse version of a model on the CPU and prints what it would take on the GPU next to the dense texture
+int ReportSparseVolume(const std::string& path, float band) {
+	marcher::Timer timer;
+	marcher::SparseVolume volume;
+	if (!volume.LoadModel(path, band))
+		return -1;
+	const glm::ivec3& dimensions = volume.Dimensions();
+	printf("%s: %dx%dx%d voxels, %zu of %zu bricks within %.1f voxels of the surface, built in %f MS\n", path.c_str(), dimensions.x, dimensions.y, dimensions.z,
+		volume.ResidentBricks(), volume.BrickCount(), band, timer.CurrentTime<float>() * 1000.f);
+	printf("Sparse %.2f MB with a %d bit index, dense R16F %.2f MB (%.1fx smaller)\n", volume.Bytes() / 1048576.0, volume.WideIndex() ? 32 : 16,
+		volume.DenseBytes() / 1048576.0, (double)volume.DenseBytes() / volume.Bytes());
+	return 0;
+}
+
+//Command line values have to be a whole number, with nothing after it
+bool ParseArgument(const char* text, int& value) {
+	char rest;
+	return sscanf(text, "%d%c", &value, &rest) == 1;
+}
+
+bool ParseArgument(const char* text, float& value) {
+	char rest;
+	return sscanf(text, "%f%c", &value, &rest) == 1;
+}
+
+void PrintUsage(const char* program) {
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  --headless <png>          render the start up view on the CPU\n"
+		"  --render <png>            render a poster, with --spp <samples> and --cpu\n"
+		"  --benchmark <frames>      time the CPU marcher\n"
+		"  --gpu-benchmark <frames>  time the fragment passes against the compute marcher\n"
+		"  --width <pixels> --height <pixels> --threads <count>\n"
+		"  --view <0-3> --heat-scale <steps> --relaxation <1-1.9>\n"
+		"  --convert-vol <text> <binary>\n"
+		"  --sparse-vol <model> [--band <voxels>]\n", program);
+}
+
+int main(int argc, char** argv) {
+	std::string headlessPath, posterPath, convertFrom, convertTo, sparsePath;
+	float sparseBand = marcher::SparseVolume::DefaultBand;
+	int headlessWidth = 1280, headlessHeight = 720;
+	unsigned int headlessThreads = 0;
+	int benchmarkFrames = 0, gpuBenchmarkFrames = 0;
+	int posterSamples = 1, threadCount = 0;
+	bool useCPU = false;
+	bool valid = true;
+	for (int i = 1; i < argc && valid; i++) {
+		std::string arg = argv[i];
+		if (arg == "--headless" && i + 1 < argc) headlessPath = argv[++i];
+		else if (arg == "--render" && i + 1 < argc) posterPath = argv[++i];
+		else if (arg == "--spp" && i + 1 < argc) valid = ParseArgument(argv[++i], posterSamples);
+		else if (arg == "--cpu") useCPU = true;
+		else if (arg == "--view" && i + 1 < argc) valid = ParseArgument(argv[++i], globals::DebugView);
+		else if (arg == "--heat-scale" && i + 1 < argc) valid = ParseArgument(argv[++i], globals::HeatmapScale);
+		else if (arg == "--relaxation" && i + 1 < argc) valid = ParseArgument(argv[++i], globals::DefaultRelaxation);
+		else if (arg == "--benchmark" && i + 1 < argc) valid = ParseArgument(argv[++i], benchmarkFrames);
+		else if (arg == "--gpu-benchmark" && i + 1 < argc) valid = ParseArgument(argv[++i], gpuBenchmarkFrames);
+		else if (arg == "--width" && i + 1 < argc) valid = ParseArgument(argv[++i], headlessWidth);
+		else if (arg == "--height" && i + 1 < argc) valid = ParseArgument(argv[++i], headlessHeight);
+		else if (arg == "--threads" && i + 1 < argc) valid = ParseArgument(argv[++i], threadCount);
+		else if (arg == "--convert-vol" && i + 2 < argc) {
+			convertFrom = argv[++i];
+			convertTo = argv[++i];
+		}
+		else if (arg == "--sparse-vol" && i + 1 < argc) sparsePath = argv[++i];
+		else if (arg == "--band" && i + 1 < argc) valid = ParseArgument(argv[++i], sparseBand);
+		else if (arg == "--help") valid = false;
+	}
+	//Sizes and counts of 0 would divide by zero further down
+	valid = valid && headlessWidth > 0 && headlessHeight > 0 && posterSamples > 0 && threadCount >= 0 && benchmarkFrames >= 0 && gpuBenchmarkFrames >= 0
+		&& globals::DebugView >= 0 && globals::DebugView <= 3 && globals::HeatmapScale > 0.f && sparseBand > 0.f;
+	if (!valid) {
+		PrintUsage(argv[0]);
+		return -1;
+	}
+	headlessThreads = (unsigned int)threadCount;
+	//The same range the pragma and the slider allow
+	globals::DefaultRelaxation = glm::clamp(globals::DefaultRelaxation, 1.f, 1.9f);
+	globals::MarchRelaxation = globals::DefaultRelaxation;
+	if (!convertFrom.empty()) {
+		//Text volumes become binary v2 ones that load without parsing
+		return marcher::VolumetricModel::Convert(convertFrom, convertTo) ? 0 : -1;
+	}
+	if (!sparsePath.empty()) {
+		return ReportSparseVolume(sparsePath, sparseBand);
+	}
+	if (benchmarkFrames > 0) {
+		return RunBenchmark(headlessWidth, headlessHeight, headlessThreads, benchmarkFrames);
+	}
+	if (gpuBenchmarkFrames > 0) {
+		return RunGpuBenchmark(headlessWidth, headlessHeight, gpuBenchmarkFrames);
+	}
+	if (!posterPath.empty()) {
+		return RenderPoster(posterPath, headlessWidth, headlessHeight, posterSamples, useCPU, headlessThreads);
+	}
+	if (!headlessPath.empty()) {
+		return RenderHeadless(headlessPath, headlessWidth, headlessHeight, headlessThreads);
+	}
+
+	sf::ContextSettings settings;
+	settings.depthBits = 24;
+	settings.stencilBits = 8;
+	settings.majorVersion = 4;
+	settings.minorVersion = 3;
+
+	sf::Window window(sf::VideoMode(1280, 720), "Marchtool", sf::Style::Default);
+	//window.setFramerateLimit(120);
+
+	sf::Thread UtilityThread(UtiltiyWindow, &window);
+	UtilityThread.launch();
+
+	int gladInitRes = gladLoadGL();
+	if (!gladInitRes) {
+		fprintf(stderr, "Unable to initialize glad\n");
+		window.close();
+		return -1;
+	}
+
+	glEnable(GL_TEXTURE_3D);
+
+	printf("OpenGL version supported by this platform (%s): \n", glGetString(GL_VERSION));
+
+	std::string mainSource = LoadShader();
+	std::shared_ptr<marcher::Shader> mainShader = BuildMainShader(mainSource);
+	std::shared_ptr<marcher::Shader> computeShader = BuildComputeShader(mainSource);
+	globals::ComputeSupported = computeShader != nullptr;
+	std::unique_ptr<marcher::SparseVolume> sceneVolume = LoadSceneVolume();
+
+	unsigned int VBO, VAO;
+	CreateScreenQuad(VAO, VBO);
 
 	//marcher::VolumetricModel model("bunny.vol");
 
+	//Renders the single pixel under the cursor again to read back its raw debug counts
+	marcher::TiledRenderer probe(1, 1);
+
+	marcher::RenderTarget prepass({ GL_R32F });
+
+	//Color and hit position of this frame and the last one
+	std::unique_ptr<marcher::RenderTarget> frames[2];
+	for (int i = 0; i < 2; i++)
+		frames[i] = std::unique_ptr<marcher::RenderTarget>(new marcher::RenderTarget({ GL_RGBA8, GL_RGBA32F }));
+	marcher::DepthReprojector reprojector;
+	bool historyValid = false;
+	glm::mat4 lastVP;
+
+	//Checkerboard frames are marched into here and resolved into frames[0]
+	marcher::RenderTarget marched({ GL_RGBA8, GL_RGBA32F });
+	marcher::CheckerboardResolver resolver;
+	int checkerboardParity = 0;
+
+	marcher::QualityMap qualityMap;
+	marcher::Accumulator accumulator;
+	marcher::EdgeResampler edgeResampler;
+	marcher::ComputeMarcher computeMarcher;
+	//Frames are marched into here and lit from it, lighting changes alone don't march again
+	marcher::GBuffer gbuffer;
+	marcher::ShadowBaker shadowBaker;
+	marcher::AOBaker aoBaker;
+
+	marcher::GpuTimer gpuTimer;
+	marcher::ResolutionController resolutionController;
+
 	glm::vec3 cameraRot = glm::vec3();
 	marcher::Camera camera = marcher::Camera(glm::vec3(0, 0, 1), glm::vec3(0, 0, 0));
 
@@ -215,6 +922,11 @@ int main() {
 	unsigned int TotalFrames = 0;
 	float totalTime = 0;
 
+	//How many frames in a row have been drawn with lastFrameHash
+	const int SettleFrames = 2;
+	unsigned long long lastFrameHash = 0;
+	int sameFrames = 0;
+
 	bool active = true, mouselook = false;
 	while (window.isOpen()) {
 		window.setVerticalSyncEnabled(globals::VSync);
@@ -233,11 +945,22 @@ int main() {
 			}
 			else if (event.type == sf::Event::Resized) {
 				glViewport(0, 0, window.getSize().x, window.getSize().y);
+				historyValid = false;
 			}
 			else if (event.type == sf::Event::KeyPressed) {
 				if (event.key.code == sf::Keyboard::F1) {
 					printf("Reloading Shader...\n");
-					mainShader = std::unique_ptr<marcher::Shader>(new marcher::Shader("main.vs", "main.fs"));
+					//Both programs and the scene's pragmas and volume come from shader.fs again, the same way as at start up
+					std::string source = LoadShader();
+					mainShader = BuildMainShader(source);
+					computeShader = BuildComputeShader(source);
+					globals::ComputeSupported = computeShader != nullptr;
+					sceneVolume = LoadSceneVolume();
+					historyValid = false;
+					sameFrames = 0;
+					gbuffer.Invalidate();
+					shadowBaker.Invalidate();
+					aoBaker.Invalidate();
 				}
 				else if (event.key.code == sf::Keyboard::F) {
 					mouselook = !mouselook;
@@ -313,32 +1036,263 @@ int main() {
 		glClearColor(0.5f, 0.5f, 0.5f, 1.f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
+		glm::ivec2 windowSize = glm::ivec2(window.getSize().x, window.getSize().y);
+		//With dynamic resolution the frame is rendered smaller and stretched over the window
+		glm::ivec2 renderSize = windowSize;
+		if (globals::DynamicResolution) {
+			renderSize = glm::max(glm::ivec2(glm::vec2(windowSize) * globals::ResolutionScale + 0.5f), glm::ivec2(1));
+		}
+
 		camera.FOV = globals::FieldOfView;
-		camera.Update(mainShader, (float)window.getSize().x / (float)window.getSize().y, glm::vec4(0, 0, window.getSize().x, window.getSize().y));
-		mainShader->SendUniform("ScreenSize", glm::vec2(window.getSize().x, window.getSize().y));
+		camera.Update((float)renderSize.x / (float)renderSize.y, glm::vec4(0, 0, renderSize.x, renderSize.y));
+
+		//The shadow map and AO volume are baked a bit each frame, shadow rays and AO taps are marched until they're done
+		bool staticScene = globals::SceneBounded && !globals::SceneUsesTime;
+		bool bakeShadows = globals::ShadowMapEnabled && globals::ShadowsEnabled && staticScene;
+		if (bakeShadows) {
+			shadowBaker.Update(globals::LightDirection, globals::SceneMin, globals::SceneMax, globals::BakeExtent);
+		}
+		bool bakeAO = globals::AOVolumeEnabled && staticScene;
+		if (bakeAO) {
+			aoBaker.Update(globals::SceneMin, globals::SceneMax, globals::BakeExtent, (size_t)(globals::AOVolumeMB * 1048576.f));
+		}
+		bool baking = (bakeShadows && !shadowBaker.Ready()) || (bakeAO && !aoBaker.Ready());
+
+		//Once the same state has been drawn SettleFrames times in a row the frame on screen won't get any better, so it's shown again instead.
+		//Time only counts when the program reads it, uniforms it doesn't use are left out of the hash
+		mainShader->Bind();
+		mainShader->ResetUniformHash();
+		camera.SendUniforms(mainShader);
+		mainShader->SendUniform("ScreenSize", glm::vec2(renderSize));
 		mainShader->SendUniform("Time", totalTime);
+		SendRenderUniforms(mainShader);
+		//The bakes below march the scene too, so its volume has to be there before them
+		SendSceneVolume(mainShader, sceneVolume.get());
+		sf::Vector2i mouse = sf::Mouse::getPosition(window);
+		unsigned long long frameHash = HashFrameState(mainShader->UniformHash(), windowSize, renderSize, glm::ivec2(mouse.x, mouse.y));
+		//Still views keep adding samples until the average converges, anything that changes the frame starts it over
+		bool accumulate = globals::AAEnabled && globals::DebugView == 0;
+		bool still = frameHash == lastFrameHash && !baking;
+		if (!accumulate || !still) {
+			accumulator.Reset();
+		}
+		globals::AASamples = accumulator.Samples();
+		globals::Idle = still && sameFrames >= SettleFrames && (!accumulate || accumulator.Converged());
+		if (globals::Idle) {
+			if (accumulate) {
+				accumulator.Present(windowSize.x, windowSize.y);
+			}
+			else {
+				frames[1]->BlitToWindow(windowSize.x, windowSize.y, GL_LINEAR);
+			}
+			//Without vsync there's nothing else to keep an idle loop from spinning
+			if (!globals::VSync) {
+				sf::sleep(sf::milliseconds(4));
+			}
+			window.display();
+			continue;
+		}
+		sameFrames = frameHash == lastFrameHash ? sameFrames + 1 : 1;
+		lastFrameHash = frameHash;
+
+		//Shifts the corners so every ray moves by the same sub-pixel offset, the first sample stays in the pixel centre
+		glm::vec2 jitter = accumulate ? (accumulator.NextOffset() - glm::vec2(0.5f)) / glm::vec2(renderSize) : glm::vec2(0.f);
+
+		gpuTimer.Begin();
+
+		//Debug views count what the fragment passes do, so they always go through those
+		bool useCompute = globals::ComputeMarching && computeShader && globals::DebugView == 0;
 
-		if (globals::Epsilon <= 0) {
-			globals::Epsilon = 0.0005f;
+		//Last frame's surfaces are still there if neither the scene nor the view changed. Edge driven quality follows last frame's colors,
+		//so it can change under a static view
+		marcher::QualityMode qualityMode = useCompute ? marcher::QUALITY_OFF : (marcher::QualityMode)globals::VariableRate;
+		marcher::GeometryState geometry = { camera.VP, camera.Position, jitter, renderSize, globals::Epsilon, globals::MarchDistance, globals::MarchRelaxation, globals::MarchSteps, (int)qualityMode };
+		bool relightOnly = !globals::SceneUsesTime && qualityMode != marcher::QUALITY_EDGES && gbuffer.Covers(geometry);
+
+		//Last frame's hits are only worth reprojecting if the scene can't have moved under them
+		bool useHistory = globals::HistoryEnabled && !globals::SceneUsesTime && historyValid && !relightOnly && !useCompute;
+		if (useHistory) {
+			reprojector.Reproject(frames[1]->Texture(1), frames[1]->Width(), frames[1]->Height(), camera, renderSize.x, renderSize.y);
 		}
-		mainShader->SendUniform("EPSILON", globals::Epsilon);
-		mainShader->SendUniform("MAX_DISTANCE", globals::MarchDistance);
-		mainShader->SendUniform("MAX_MARCHING_STEPS", globals::MarchSteps);
 
-		mainShader->SendUniform("ShadowsEnabled", (int)globals::ShadowsEnabled);
-		mainShader->SendUniform("ShadowStrength", globals::ShadowStrength);
-		mainShader->SendUniform("AOStrength", globals::AOStrength);
-		mainShader->SendUniform("AmbientColor", globals::AmbientColor);
-		mainShader->SendUniform("LightColor", globals::LightColor);
-		mainShader->SendUniform("LightDir", globals::LightDirection);
+		if (qualityMode != marcher::QUALITY_OFF) {
+			qualityMap.Update(qualityMode, renderSize.x, renderSize.y, *frames[1], historyValid, camera.Position);
+		}
 
-		mainShader->Bind();
+		bool shadowMapReady = false;
+		if (bakeShadows) {
+			if (!shadowBaker.Ready()) {
+				mainShader->Bind();
+				SendRenderUniforms(mainShader);
+				shadowBaker.Bake(mainShader, VAO);
+			}
+			shadowMapReady = shadowBaker.Ready();
+		}
+		globals::ShadowMapProgress = bakeShadows ? shadowBaker.Progress() : 0.f;
+
+		bool aoVolumeReady = false;
+		if (bakeAO) {
+			if (!aoBaker.Ready()) {
+				mainShader->Bind();
+				SendRenderUniforms(mainShader);
+				aoBaker.Bake(mainShader, VAO);
+			}
+			aoVolumeReady = aoBaker.Ready();
+		}
+		globals::AOVolumeProgress = bakeAO ? aoBaker.Progress() : 0.f;
+
+		//The passes above bind their own programs and the bakes change the main one's uniforms.
+		//The compute program shares the main one's uniforms but not their values, so it gets the same ones
+		auto sendMarchUniforms = [&](std::shared_ptr<marcher::Shader> shader) {
+			shader->Bind();
+			camera.SendUniforms(shader, jitter, glm::vec2(1.f) + jitter);
+			shader->SendUniform("ScreenSize", glm::vec2(renderSize));
+			shader->SendUniform("Time", totalTime);
+
+			SendRenderUniforms(shader);
+			SendSceneVolume(shader, sceneVolume.get());
+
+			if (shadowMapReady) {
+				shadowBaker.BindTexture(4);
+				shader->SendUniform("ShadowMap", 4);
+				shader->SendUniform("ShadowMapTransform", shadowBaker.Transform());
+				shader->SendUniform("ShadowMapTexel", shadowBaker.TexelSize());
+				shader->SendUniform("ShadowMapEnabled", 1);
+			}
+
+			if (aoVolumeReady) {
+				aoBaker.BindTexture(5);
+				shader->SendUniform("AOVolumeMin", aoBaker.Min());
+				shader->SendUniform("AOVolumeMax", aoBaker.Max());
+				shader->SendUniform("AOVolumeEnabled", 1);
+			}
+		};
+		if (useCompute && !relightOnly) {
+			sendMarchUniforms(computeShader);
+		}
+		sendMarchUniforms(mainShader);
+
+		if (useHistory) {
+			reprojector.BindTexture(2);
+			mainShader->SendUniform("HistoryDepth", 2);
+			mainShader->SendUniform("HistoryBackoff", globals::HistoryBackoff);
+			mainShader->SendUniform("HistoryEnabled", 1);
+		}
+
+		if (qualityMode != marcher::QUALITY_OFF) {
+			qualityMap.BindTexture(3);
+			mainShader->SendUniform("QualityMap", 3);
+			mainShader->SendUniform("QualityTileSize", marcher::QualityMap::TileSize);
+			mainShader->SendUniform("VariableRate", 1);
+		}
+
+		if (globals::PrepassEnabled && !relightOnly && !useCompute) {
+			//Each prepass pixel covers PrepassScale pixels of the frame, rounded up so the edges are covered too
+			glm::ivec2 prepassSize = (renderSize + globals::PrepassScale - 1) / globals::PrepassScale;
+			prepass.Resize(prepassSize.x, prepassSize.y);
+			prepass.Bind();
+			camera.SendUniforms(mainShader, jitter, glm::vec2(prepassSize * globals::PrepassScale) / glm::vec2(renderSize) + jitter);
+			mainShader->SendUniform("ScreenSize", glm::vec2(prepassSize));
+			mainShader->SendUniform("DepthPrepass", 1);
+			glBindVertexArray(VAO);
+			glDrawArrays(GL_TRIANGLES, 0, 6);
+
+			camera.SendUniforms(mainShader, jitter, glm::vec2(1.f) + jitter);
+			mainShader->SendUniform("ScreenSize", glm::vec2(renderSize));
+			mainShader->SendUniform("DepthPrepass", 0);
+			prepass.BindTexture(1);
+			mainShader->SendUniform("PrepassDepth", 1);
+			mainShader->SendUniform("PrepassScale", globals::PrepassScale);
+			mainShader->SendUniform("PrepassEnabled", 1);
+		}
 
 		/*model.Bind(0);
 		mainShader->SendUniform("Model", 0);*/
 
-		glBindVertexArray(VAO); 
-		glDrawArrays(GL_TRIANGLES, 0, 6);
+		//The frame goes through an offscreen target so its hit positions are still around next frame.
+		//When only the lighting changed every pixel is relit from the G-buffer, there's nothing for the checkerboard to save.
+		//Accumulated samples need every pixel marched too, and so does the compute marcher
+		bool checkerboard = globals::CheckerboardEnabled && !relightOnly && accumulator.Samples() == 0 && !useCompute;
+		marcher::RenderTarget& target = checkerboard ? marched : *frames[0];
+		if (checkerboard) {
+			checkerboardParity ^= 1;
+			mainShader->SendUniform("CheckerboardEnabled", 1);
+			mainShader->SendUniform("CheckerboardParity", checkerboardParity);
+		}
+		glBindVertexArray(VAO);
+		if (useCompute && !relightOnly) {
+			//Marches and lights the frame in one go, relighting only is left to the lighting pass like on the fragment path
+			computeShader->Bind();
+			computeMarcher.Render(computeShader, *frames[0], gbuffer, geometry);
+			mainShader->Bind();
+		}
+		else {
+			if (!relightOnly) {
+				gbuffer.Bind(geometry, checkerboard);
+				mainShader->SendUniform("GeometryPass", 1);
+				glDrawArrays(GL_TRIANGLES, 0, 6);
+				mainShader->SendUniform("GeometryPass", 0);
+			}
+			gbuffer.BindTextures(mainShader, 6);
+			mainShader->SendUniform("LightingPass", 1);
+			target.Resize(renderSize.x, renderSize.y);
+			target.Bind();
+			glDrawArrays(GL_TRIANGLES, 0, 6);
+			mainShader->SendUniform("LightingPass", 0);
+		}
+		if (checkerboard) {
+			resolver.Resolve(marched, *frames[1], historyValid, lastVP, camera, checkerboardParity, *frames[0]);
+			mainShader->Bind();
+			mainShader->SendUniform("CheckerboardEnabled", 0);
+		}
+		//Once samples accumulate every pixel gets more rays anyway, the edges only need them while the view moves
+		if (globals::EdgeAAEnabled && globals::DebugView == 0 && accumulator.Samples() == 0) {
+			edgeResampler.FindEdges(gbuffer, *frames[0], camera);
+			mainShader->Bind();
+			edgeResampler.Resample(mainShader, VAO, *frames[0], globals::EdgeSamples);
+		}
+		if (accumulate) {
+			accumulator.Add(*frames[0]);
+			accumulator.Present(windowSize.x, windowSize.y);
+			mainShader->Bind();
+		}
+		else {
+			marcher::RenderTarget::Unbind(windowSize.x, windowSize.y);
+			frames[0]->BlitToWindow(windowSize.x, windowSize.y, GL_LINEAR);
+		}
+		std::swap(frames[0], frames[1]);
+		historyValid = true;
+		lastVP = camera.VP;
+		gpuTimer.End();
+
+		float gpuMS;
+		if (gpuTimer.Poll(gpuMS)) {
+			globals::GPUMS = gpuMS;
+			if (globals::DynamicResolution) {
+				globals::ResolutionScale = resolutionController.Update(gpuMS, globals::FrameBudget);
+			}
+			globals::ScaleHistory[globals::ScaleHistoryOffset] = globals::DynamicResolution ? globals::ResolutionScale : 1.f;
+			globals::ScaleHistoryOffset = (globals::ScaleHistoryOffset + 1) % globals::ScaleHistorySize;
+		}
+		float resampled;
+		if (edgeResampler.Poll(resampled)) {
+			globals::EdgeResampled = resampled;
+		}
+
+		if (globals::DebugView != 0) {
+			globals::ProbeValid = mouse.x >= 0 && mouse.y >= 0 && mouse.x < (int)window.getSize().x && mouse.y < (int)window.getSize().y;
+			if (globals::ProbeValid) {
+				glm::vec3 counts;
+				//The probe draws a single pixel on its own, it can't use the per frame textures
+				mainShader->SendUniform("PrepassEnabled", 0);
+				mainShader->SendUniform("HistoryEnabled", 0);
+				mainShader->SendUniform("VariableRate", 0);
+				mainShader->SendUniform("DebugRaw", 1);
+				probe.RenderRegion(mainShader, camera, window.getSize().x, window.getSize().y, glm::ivec4(mouse.x, mouse.y, 1, 1), &counts);
+				mainShader->SendUniform("DebugRaw", 0);
+				globals::ProbeCounts = glm::ivec3(counts);
+			}
+		}
 
 		glBindTexture(GL_TEXTURE_3D, 0);
 